@@ -0,0 +1,296 @@
+#include "benchmark.hpp"
+
+#include <v8.h>
+#include <time.h>
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+    namespace {
+        struct Entry
+        {
+            std::string name;
+            bench_func func;
+        };
+
+        struct Result
+        {
+            std::string name;
+            std::size_t iterations;
+            double real_time;           // ns per iteration
+            double cpu_time;
+        };
+
+        struct Options
+        {
+            std::string filter = ".";
+            double min_time = 0.5;
+            std::string format = "console";
+            std::string out;
+        };
+
+        const std::size_t MaxIterations = 1000000000;
+
+        std::vector<Entry>& registry()
+        {
+            static std::vector<Entry> entries;
+            return entries;
+        }
+
+        // cpu time of the calling thread, V8's background threads don't count
+        std::chrono::nanoseconds thread_cpu_now()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+        }
+
+        bool parse_option(const std::string& arg, const char* name, std::string& value)
+        {
+            auto prefix = std::string("--") + name + "=";
+            if(arg.compare(0, prefix.size(), prefix) != 0)
+                return false;
+            value = arg.substr(prefix.size());
+            return true;
+        }
+
+        Options parse_options(int argc, char** argv)
+        {
+            Options options;
+            for(int i = 1; i < argc; ++i)
+            {
+                std::string arg = argv[i];
+                std::string value;
+                if(parse_option(arg, "benchmark_filter", value))
+                {
+                    options.filter = value;
+                } else if(parse_option(arg, "benchmark_min_time", value)) {
+                    options.min_time = std::stod(value);
+                } else if(parse_option(arg, "benchmark_format", value)) {
+                    if(value != "console" && value != "json")
+                        throw std::invalid_argument("Unknown benchmark format '" + value + "'");
+                    options.format = value;
+                } else if(parse_option(arg, "benchmark_out", value)) {
+                    options.out = value;
+                } else {
+                    throw std::invalid_argument("Unknown argument '" + arg + "'");
+                }
+            }
+            return options;
+        }
+
+        Result run_one(const Entry& entry, double minTime)
+        {
+            std::size_t iterations = 1;
+            while(true)
+            {
+                State state(iterations);
+                entry.func(state);
+                auto real = std::chrono::duration<double>(state.real_time()).count();
+
+                if(real >= minTime || iterations >= MaxIterations)
+                {
+                    return Result{
+                        entry.name,
+                        iterations,
+                        double(state.real_time().count()) / iterations,
+                        double(state.cpu_time().count()) / iterations
+                    };
+                }
+
+                // aim a bit over the minimum time, but grow at most tenfold
+                // while the measurement is still too short to be trusted
+                double multiplier = minTime * 1.4 / std::max(real, 1e-9);
+                if(real < minTime / 10)
+                    multiplier = std::min(multiplier, 10.0);
+                auto next = std::size_t(iterations * multiplier);
+                iterations = std::min(std::max(next, iterations + 1), MaxIterations);
+            }
+        }
+
+        std::string escape(const std::string& s)
+        {
+            std::string result;
+            for(char c : s)
+            {
+                if(c == '"' || c == '\\')
+                    result += '\\';
+                result += c;
+            }
+            return result;
+        }
+
+        void write_json(std::ostream& out, const char* executable, const std::vector<Result>& results)
+        {
+            auto now = std::time(nullptr);
+            std::tm local{};
+            localtime_r(&now, &local);
+
+            out << "{\n"
+                << "  \"context\": {\n"
+                << "    \"date\": \"" << std::put_time(&local, "%Y-%m-%dT%H:%M:%S%z") << "\",\n"
+                << "    \"executable\": \"" << escape(executable) << "\",\n"
+                << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+                << "    \"v8_version\": \"" << v8::V8::GetVersion() << "\",\n"
+#if defined(NDEBUG)
+                << "    \"library_build_type\": \"release\"\n"
+#else
+                << "    \"library_build_type\": \"debug\"\n"
+#endif
+                << "  },\n"
+                << "  \"benchmarks\": [";
+
+            for(std::size_t i = 0; i < results.size(); ++i)
+            {
+                auto& r = results[i];
+                out << (i ? ",\n" : "\n")
+                    << "    {\n"
+                    << "      \"name\": \"" << escape(r.name) << "\",\n"
+                    << "      \"run_name\": \"" << escape(r.name) << "\",\n"
+                    << "      \"run_type\": \"iteration\",\n"
+                    << "      \"iterations\": " << r.iterations << ",\n"
+                    << "      \"real_time\": " << std::fixed << std::setprecision(4) << r.real_time << ",\n"
+                    << "      \"cpu_time\": " << r.cpu_time << ",\n"
+                    << "      \"time_unit\": \"ns\"\n"
+                    << "    }";
+                out.unsetf(std::ios::floatfield);
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        void write_console_header(std::ostream& out, std::size_t nameWidth)
+        {
+            out << std::left << std::setw(int(nameWidth)) << "Benchmark"
+                << std::right << std::setw(14) << "Time"
+                << std::setw(14) << "CPU"
+                << std::setw(14) << "Iterations" << "\n"
+                << std::string(nameWidth + 42, '-') << std::endl;
+        }
+
+        void write_console_line(std::ostream& out, std::size_t nameWidth, const Result& r)
+        {
+            out << std::left << std::setw(int(nameWidth)) << r.name
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(11) << r.real_time << " ns"
+                << std::setw(11) << r.cpu_time << " ns"
+                << std::setw(14) << r.iterations << std::endl;
+            out.unsetf(std::ios::floatfield);
+        }
+    }
+
+    State::State(std::size_t iterations)
+        : _iterations(iterations)
+        , _remaining(iterations)
+    {
+        assert(iterations > 0);
+    }
+
+    std::size_t State::iterations() const
+    {
+        return _iterations;
+    }
+
+    void State::start_timing()
+    {
+        assert(!_running);
+        _running = true;
+        _cpuStart = thread_cpu_now();
+        _realStart = std::chrono::steady_clock::now();
+    }
+
+    void State::stop_timing()
+    {
+        if(!_running)
+            return;
+        _realTime += std::chrono::steady_clock::now() - _realStart;
+        _cpuTime += thread_cpu_now() - _cpuStart;
+        _running = false;
+    }
+
+    std::chrono::nanoseconds State::real_time() const
+    {
+        return _realTime;
+    }
+
+    std::chrono::nanoseconds State::cpu_time() const
+    {
+        return _cpuTime;
+    }
+
+    Registrar::Registrar(const char* name, bench_func func)
+    {
+        registry().push_back(Entry{name, func});
+    }
+
+    int run(int argc, char** argv)
+    {
+        Options options;
+        std::regex filter;
+        try {
+            options = parse_options(argc, argv);
+            filter = std::regex(options.filter);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        std::vector<Entry> selected;
+        std::copy_if(registry().begin(), registry().end(), std::back_inserter(selected), [&filter](const Entry& entry)
+        {
+            return std::regex_search(entry.name, filter);
+        });
+        std::sort(selected.begin(), selected.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.name < b.name;
+        });
+
+        if(selected.empty())
+        {
+            std::cerr << "No benchmark matches '" << options.filter << "'" << std::endl;
+            return 1;
+        }
+
+        std::size_t nameWidth = 10;
+        for(auto& entry : selected)
+        {
+            nameWidth = std::max(nameWidth, entry.name.size() + 2);
+        }
+
+        bool console = options.format == "console";
+        if(console)
+            write_console_header(std::cout, nameWidth);
+
+        std::vector<Result> results;
+        for(auto& entry : selected)
+        {
+            results.push_back(run_one(entry, options.min_time));
+            if(console)
+                write_console_line(std::cout, nameWidth, results.back());
+        }
+
+        if(!console)
+            write_json(std::cout, argv[0], results);
+
+        if(!options.out.empty())
+        {
+            std::ofstream out(options.out);
+            if(!out)
+            {
+                std::cerr << "Failed to open '" << options.out << "'" << std::endl;
+                return 1;
+            }
+            write_json(out, argv[0], results);
+        }
+        return 0;
+    }
+}
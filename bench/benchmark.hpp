@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <boost/noncopyable.hpp>
+
+namespace bench {
+
+    // Iteration state of one run of a benchmark.
+    // Only the loop is timed, everything before the first keep_running()
+    // call is setup:
+    //
+    //     SC_BENCHMARK(my_benchmark)
+    //     {
+    //         // setup
+    //         while(state.keep_running())
+    //         {
+    //             // measured
+    //         }
+    //     }
+    //
+    // Benchmarks that loop on their own, e.g. inside a script, run
+    // iterations() times between start_timing() and stop_timing() instead.
+    class State: boost::noncopyable
+    {
+    public:
+        explicit State(std::size_t iterations);
+
+        bool keep_running()
+        {
+            if(_remaining == 0)
+            {
+                stop_timing();
+                return false;
+            }
+            if(_remaining-- == _iterations)
+                start_timing();
+            return true;
+        }
+
+        std::size_t iterations() const;
+
+        void start_timing();
+        void stop_timing();
+
+        std::chrono::nanoseconds real_time() const;
+        std::chrono::nanoseconds cpu_time() const;
+
+    private:
+        const std::size_t _iterations;
+        std::size_t _remaining;
+        bool _running = false;
+
+        std::chrono::steady_clock::time_point _realStart{};
+        std::chrono::nanoseconds _cpuStart{};
+        std::chrono::nanoseconds _realTime{};
+        std::chrono::nanoseconds _cpuTime{};
+    };
+
+    using bench_func = void (*)(State&);
+
+    struct Registrar
+    {
+        Registrar(const char* name, bench_func func);
+    };
+
+    // keeps the compiler from optimizing away a value that is never used
+    template<typename T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Runs all registered benchmarks matching the filter.
+    // Understands a subset of Google Benchmark's options and writes the same
+    // json, so results can be compared with its tools:
+    //   --benchmark_filter=<regex>
+    //   --benchmark_min_time=<seconds>
+    //   --benchmark_format=<console|json>
+    //   --benchmark_out=<file>             (always json)
+    int run(int argc, char** argv);
+}
+
+#define SC_BENCHMARK(name) \
+    static void name(::bench::State& state); \
+    static ::bench::Registrar name##_registrar(#name, &name); \
+    static void name(::bench::State& state)
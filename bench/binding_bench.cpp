@@ -0,0 +1,220 @@
+#include "benchmark.hpp"
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "scripting/binding.hpp"
+#include "scripting/script_budget.hpp"
+#include "scripting/snapshot.hpp"
+
+using namespace bd;
+using namespace v8;
+
+namespace {
+    // An isolate from the default snapshot, locked and with an entered
+    // context, like the one a processor runs its messages in.
+    class BenchIsolate: boost::noncopyable
+    {
+    public:
+        BenchIsolate()
+            : _locker(_handle.iso)
+            , _isolateScope(_handle.iso)
+            , _handleScope(_handle.iso)
+            , _ctx(Context::New(_handle.iso))
+            , _contextScope(_ctx)
+        {
+        }
+
+        Isolate* iso() const
+        {
+            return _handle.iso;
+        }
+
+        Local<Context> ctx() const
+        {
+            return _ctx;
+        }
+
+        void set(const char* name, Local<Value> value)
+        {
+            _ctx->Global()->Set(_ctx, str(name), value).FromJust();
+        }
+
+        Local<Value> eval(const std::string& code)
+        {
+            auto script = unwrap(Script::Compile(_ctx, str(code)), "Failed to compile benchmark script");
+            return unwrap(script->Run(_ctx), "Failed to run benchmark script");
+        }
+
+        // Times state.iterations() runs of body inside a script loop.
+        // The loop is warmed up first, so the optimized code is measured.
+        void run_loop(bench::State& state, const std::string& body)
+        {
+            auto loop = eval("(function(n) { for(let i = 0; i < n; ++i) { " + body + " } })").As<Function>();
+            call_loop(loop, 10000);
+
+            state.start_timing();
+            call_loop(loop, state.iterations());
+            state.stop_timing();
+        }
+
+    private:
+        void call_loop(Local<Function> loop, std::size_t n)
+        {
+            Local<Value> arg = Number::New(_handle.iso, double(n));
+            unwrap(loop->Call(_ctx, _ctx->Global(), 1, &arg), "Benchmark loop failed");
+        }
+
+    private:
+        struct Handle
+        {
+            Handle()
+                : iso(ContextSnapshot::Default()->acquire(ScriptBudget().heap_limit_mb))
+            {
+            }
+
+            ~Handle()
+            {
+                ContextSnapshot::Default()->release(iso, ScriptBudget().heap_limit_mb, true);
+            }
+
+            Isolate* iso;
+        };
+
+        // declared first, so the isolate is released after the scopes are left
+        Handle _handle;
+        Locker _locker;
+        Isolate::Scope _isolateScope;
+        HandleScope _handleScope;
+        Local<Context> _ctx;
+        Context::Scope _contextScope;
+    };
+
+    // Every C++ -> JS iteration opens a HandleScope, like callback_entry
+    // does, otherwise the handles of all iterations would pile up.
+    template<typename T>
+    void to_local_bench(bench::State& state, const T& value)
+    {
+        BenchIsolate bi;
+        auto iso = bi.iso();
+        auto ctx = bi.ctx();
+        while(state.keep_running())
+        {
+            HandleScope scope(iso);
+            bench::do_not_optimize(toLocal(iso, ctx, value));
+        }
+    }
+
+    template<typename T>
+    void from_local_bench(bench::State& state, const char* js)
+    {
+        BenchIsolate bi;
+        auto iso = bi.iso();
+        auto ctx = bi.ctx();
+        auto local = bi.eval(js);
+        while(state.keep_running())
+        {
+            HandleScope scope(iso);
+            bench::do_not_optimize(fromLocal<T>(iso, ctx, local));
+        }
+    }
+
+    struct Target
+    {
+        void noop()
+        {
+        }
+
+        void take_double(double v)
+        {
+            sum += v;
+        }
+
+        double twice(double v)
+        {
+            return v * 2;
+        }
+
+        void take_ints(int32_t a, int32_t b, int32_t c)
+        {
+            sum += a + b + c;
+        }
+
+        void take_vec2(const vec2& v)
+        {
+            sum += v.x + v.y;
+        }
+
+        vec2 position() const
+        {
+            return pos;
+        }
+
+        std::string echo(const std::string& s)
+        {
+            return s;
+        }
+
+        double sum = 0;
+        vec2 pos{3.5f, -1.25f};
+    };
+
+    // Binds f as "f" and times calls of it from a script loop.
+    template<typename Wrapper>
+    void call_bench(bench::State& state, const std::string& call)
+    {
+        BenchIsolate bi;
+        Target target;
+        bi.set("f", Wrapper::NewFunction(bi.ctx(), &target));
+        bi.run_loop(state, call);
+        bench::do_not_optimize(target.sum);
+    }
+
+    // Same as call_bench, but f takes its object from the context's ThisSlot.
+    template<typename Wrapper>
+    void slot_call_bench(bench::State& state, const std::string& call)
+    {
+        BenchIsolate bi;
+        Target target;
+        bi.ctx()->SetAlignedPointerInEmbedderData(ThisSlot, &target);
+        bi.set("f", Wrapper::NewSlotFunction(bi.ctx()));
+        bi.run_loop(state, call);
+        bench::do_not_optimize(target.sum);
+    }
+}
+
+// C++ -> JS
+SC_BENCHMARK(to_local_bool)      { to_local_bench(state, true); }
+SC_BENCHMARK(to_local_int32)     { to_local_bench(state, int32_t(42)); }
+SC_BENCHMARK(to_local_double)    { to_local_bench(state, 4.2); }
+SC_BENCHMARK(to_local_string)    { to_local_bench(state, std::string("starcode")); }
+SC_BENCHMARK(to_local_vec2)      { to_local_bench(state, vec2(1.5f, 2.5f)); }
+SC_BENCHMARK(to_local_vector16)  { to_local_bench(state, std::vector<double>(16, 4.2)); }
+SC_BENCHMARK(to_local_vec2_vector64) { to_local_bench(state, std::vector<vec2>(64, vec2(1.5f, 2.5f))); }
+SC_BENCHMARK(to_local_vec2_array64)  { to_local_bench(state, Vec2Array{std::vector<vec2>(64, vec2(1.5f, 2.5f))}); }
+
+// JS -> C++
+SC_BENCHMARK(from_local_bool)     { from_local_bench<bool>(state, "true"); }
+SC_BENCHMARK(from_local_int32)    { from_local_bench<int32_t>(state, "42"); }
+SC_BENCHMARK(from_local_double)   { from_local_bench<double>(state, "4.2"); }
+SC_BENCHMARK(from_local_string)   { from_local_bench<std::string>(state, "'starcode'"); }
+SC_BENCHMARK(from_local_vec2)     { from_local_bench<vec2>(state, "({x: 1.5, y: 2.5})"); }
+SC_BENCHMARK(from_local_vector16) { from_local_bench<std::vector<double>>(state, "new Array(16).fill(4.2)"); }
+SC_BENCHMARK(from_local_vec2_array64) { from_local_bench<Vec2Array>(state, "new Float32Array(128).fill(4.2)"); }
+
+// script calls through function_wrapper::callback_entry, including the loop
+SC_BENCHMARK(loop_empty)
+{
+    BenchIsolate bi;
+    bi.run_loop(state, "");
+}
+
+SC_BENCHMARK(call_void)              { call_bench<FWrap(&Target::noop)>(state, "f();"); }
+SC_BENCHMARK(call_void_double)       { call_bench<FWrap(&Target::take_double)>(state, "f(i);"); }
+SC_BENCHMARK(call_double_double)     { call_bench<FWrap(&Target::twice)>(state, "f(i);"); }
+SC_BENCHMARK(call_void_int32x3)      { call_bench<FWrap(&Target::take_ints)>(state, "f(i, 2, 3);"); }
+SC_BENCHMARK(call_void_vec2)         { call_bench<FWrap(&Target::take_vec2)>(state, "f({x: i, y: 1});"); }
+SC_BENCHMARK(call_vec2)              { call_bench<FWrap(&Target::position)>(state, "f();"); }
+SC_BENCHMARK(call_string_string)     { call_bench<FWrap(&Target::echo)>(state, "f('starcode');"); }
+SC_BENCHMARK(call_slot_void_double)  { slot_call_bench<FWrap(&Target::take_double)>(state, "f(i);"); }
+SC_BENCHMARK(call_slot_vec2)         { slot_call_bench<FWrap(&Target::position)>(state, "f();"); }
@@ -0,0 +1,9 @@
+#include "benchmark.hpp"
+#include "scripting/processor.hpp"
+
+int main(int argc, char** argv)
+{
+    // initializes V8, the benchmarks run in their own isolates on this thread
+    auto pool = V8ProcessorPool::Create(1);
+    return bench::run(argc, argv);
+}
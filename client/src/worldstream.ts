@@ -0,0 +1,164 @@
+// Client side of the binary world state stream (see src/server/world_stream.hpp).
+
+const PositionQuantum = 1 / 16;
+const VelocityQuantum = 1 / 16;
+const HistorySize = 32;
+const utf8 = new TextDecoder("utf-8");
+
+const enum Flags {
+    ChangedX = 1 << 0,
+    ChangedY = 1 << 1,
+    ChangedVX = 1 << 2,
+    ChangedVY = 1 << 3,
+    New = 1 << 4
+}
+
+export interface ObjectState {
+    id: number;
+    name: string;
+    x: number;      // quantized, use position()/velocity()
+    y: number;
+    vx: number;
+    vy: number;
+}
+
+export function position(state: ObjectState): {x: number, y: number} {
+    return {x: state.x * PositionQuantum, y: state.y * PositionQuantum};
+}
+
+export function velocity(state: ObjectState): {x: number, y: number} {
+    return {x: state.vx * VelocityQuantum, y: state.vy * VelocityQuantum};
+}
+
+class Reader {
+    private pos = 0;
+
+    constructor(private data: Uint8Array) {
+    }
+
+    varint(): number {
+        let value = 0;
+        let factor = 1;
+        while (true) {
+            if (this.pos >= this.data.length) {
+                throw "unexpected end of world stream message";
+            }
+            const b = this.data[this.pos++];
+            value += (b & 0x7f) * factor;
+            if (!(b & 0x80)) {
+                return value;
+            }
+            factor *= 128;
+        }
+    }
+
+    svarint(): number {
+        const v = this.varint();
+        return v % 2 ? -(v + 1) / 2 : v / 2;
+    }
+
+    byte(): number {
+        if (this.pos >= this.data.length) {
+            throw "unexpected end of world stream message";
+        }
+        return this.data[this.pos++];
+    }
+
+    string(length: number): string {
+        if (this.pos + length > this.data.length) {
+            throw "unexpected end of world stream message";
+        }
+        const bytes = this.data.subarray(this.pos, this.pos + length);
+        this.pos += length;
+        return utf8.decode(bytes);
+    }
+}
+
+interface Snapshot {
+    sequence: number;
+    states: ObjectState[];
+}
+
+export class WorldStream {
+    private received: (Snapshot | undefined)[] = new Array(HistorySize);
+    private socket: WebSocket;
+
+    objects: ObjectState[] = [];
+    onUpdate: (objects: ObjectState[]) => void = () => {};
+
+    constructor(url: string) {
+        this.socket = new WebSocket(url);
+        this.socket.binaryType = "arraybuffer";
+        this.socket.onmessage = (ev: MessageEvent) => {
+            const sequence = this.decode(new Uint8Array(ev.data));
+            this.socket.send(JSON.stringify({ack: sequence}));
+            this.onUpdate(this.objects);
+        };
+    }
+
+    close() {
+        this.socket.close();
+    }
+
+    private decode(data: Uint8Array): number {
+        const reader = new Reader(data);
+        const sequence = reader.varint();
+        const baseline = reader.varint();
+
+        let base: ObjectState[] = [];
+        if (baseline) {
+            const snapshot = this.received[baseline % HistorySize];
+            if (!snapshot || snapshot.sequence !== baseline) {
+                throw "unknown world stream baseline " + baseline;
+            }
+            base = snapshot.states;
+        }
+
+        const removed = new Set<number>();
+        let id = 0;
+        for (let count = reader.varint(); count > 0; --count) {
+            id += reader.varint();
+            removed.add(id);
+        }
+
+        const states: ObjectState[] = [];
+        let b = 0;
+        const takeBase = (until: number) => {
+            for (; b < base.length && base[b].id < until; ++b) {
+                if (!removed.has(base[b].id)) {
+                    states.push(base[b]);
+                }
+            }
+        };
+
+        id = 0;
+        for (let count = reader.varint(); count > 0; --count) {
+            id += reader.varint();
+            takeBase(id);
+
+            const flags = reader.byte();
+            let state: ObjectState;
+            if (flags & Flags.New) {
+                state = {id: id, name: reader.string(reader.varint()), x: 0, y: 0, vx: 0, vy: 0};
+                if (b < base.length && base[b].id === id) {
+                    ++b;
+                }
+            } else {
+                if (b >= base.length || base[b].id !== id) {
+                    throw "world stream delta for unknown object";
+                }
+                state = Object.assign({}, base[b++]);
+            }
+            if (flags & Flags.ChangedX) state.x += reader.svarint();
+            if (flags & Flags.ChangedY) state.y += reader.svarint();
+            if (flags & Flags.ChangedVX) state.vx += reader.svarint();
+            if (flags & Flags.ChangedVY) state.vy += reader.svarint();
+            states.push(state);
+        }
+        takeBase(Infinity);
+
+        this.received[sequence % HistorySize] = {sequence: sequence, states: states};
+        this.objects = states;
+        return sequence;
+    }
+}
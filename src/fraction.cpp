@@ -43,3 +43,18 @@ const std::vector<Player*> Fraction::players() const
 {
     return _members;
 }
+
+const std::vector<GameObject*>& Fraction::visible_objects() const
+{
+    return _visible;
+}
+
+subscriptable<obj_ptr>& Fraction::on_vision()
+{
+    return _onVision;
+}
+
+subscriptable<obj_ptr>& Fraction::on_vision_lost()
+{
+    return _onVisionLost;
+}
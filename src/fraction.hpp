@@ -3,6 +3,8 @@
 #include <boost/noncopyable.hpp>
 #include <vector>
 #include "player.hpp"
+#include "game_object.hpp"
+#include "subscription.hpp"
 
 namespace detail {
     struct fraction_id_tag
@@ -21,6 +23,7 @@ MAKE_ID_HASH(fraction_id)
 
 class Fraction: boost::noncopyable
 {
+    friend class Universe;
 public:
     Fraction(const fraction_id& id, const std::string& name);
 
@@ -30,9 +33,19 @@ public:
     const std::string& name() const;
     const std::vector<Player*> players() const;
 
+    // shared vision: everything any object of the fraction sees, including those objects
+    // itself. Updated by the universe once per tick, in a fixed order.
+    const std::vector<GameObject*>& visible_objects() const;
+    subscriptable<obj_ptr>& on_vision();
+    subscriptable<obj_ptr>& on_vision_lost();
+
 private:
     const std::string _name;
     const fraction_id _id;
 
     std::vector<Player*> _members;
+
+    std::vector<GameObject*> _visible{};
+    subscriptable<obj_ptr> _onVision{};
+    subscriptable<obj_ptr> _onVisionLost{};
 };
\ No newline at end of file
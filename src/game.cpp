@@ -1,12 +1,14 @@
 #include "game.hpp"
 
 #include "scripting/processor.hpp"
+#include "scripting/code_cache.hpp"
 #include "objects/asteroid.hpp"
 #include "objects/spaceship.hpp"
 
 #include <cassert>
 #include <tuple>
-#include <iostream>
+#include <stdexcept>
+#include "log.hpp"
 
 namespace {
     Game* _CurrentGame = nullptr;
@@ -14,19 +16,29 @@ namespace {
 
 
 Game::Game(const GameConfig& config)
-    : _service(new boost::asio::io_service())
+    : _universe(config.simulation_threads)
+    , _service(new boost::asio::io_service())
+    , _scheduler(config.tick_rate, config.max_catch_up_ticks)
+    , _metricsReportInterval(config.metrics_report_interval)
+    , _scriptTiers(config.script_tiers)
+    , _streamInterval(std::max(1u, config.tick_rate / std::max(1u, config.stream_rate)))
 {
     assert(!_CurrentGame);
     _CurrentGame = this;
+    if(_scriptTiers.empty())
+        throw std::runtime_error("at least one script tier is needed");
 
-    _ppool = V8ProcessorPool::Create(1);
+    _ppool = V8ProcessorPool::Create(config.script_threads);
+    CodeCache::Global().set_capacity(config.script_cache_mb * 1024 * 1024);
+    CodeCache::Global().set_directory(config.script_cache_dir);
 
-    auto make_player = [this](id_value_type id, const std::string& name) -> Player*
+    auto make_player = [this, &config](id_value_type id, const std::string& name) -> Player*
     {
+        auto tier = config.player_tiers.count(name)? config.player_tiers.at(name) : 0u;
         auto fid = fraction_id{id};
         auto& f = _fractions.emplace(std::piecewise_construct, std::make_tuple(fid), std::make_tuple(fid, name + "-fraction")).first->second;
         auto pid = player_id{id};
-        auto& p = _players.emplace(std::piecewise_construct, std::make_tuple(pid), std::make_tuple(pid, name, std::ref(f))).first->second;
+        auto& p = _players.emplace(std::piecewise_construct, std::make_tuple(pid), std::make_tuple(pid, name, std::ref(f), tier)).first->second;
         _hashToPlayer.emplace(name, &p);
         f.add_player(p);
         return &p;
@@ -73,8 +85,15 @@ Fraction& Game::resolve_fraction(const fraction_id& id)
 
 obj_ptr Game::resolve_object(const obj_id& id)
 {
-    assert(_objects.count(id));
-    return _objects.at(id);
+    auto obj = _objects.find(id.value());
+    assert(obj);
+    return obj? *obj : nullptr;
+}
+
+GameObject* Game::find_object(const obj_id& id)
+{
+    auto obj = _objects.find(id.value());
+    return obj? obj->get() : nullptr;
 }
 
 
@@ -86,11 +105,21 @@ Player* Game::get_player_by_hash(const std::string& hash)
     return it->second;
 }
 
+const ScriptBudget& Game::script_budget(const Player& player) const
+{
+    return _scriptTiers[std::min<std::size_t>(player.tier(), _scriptTiers.size() - 1)];
+}
+
 Universe& Game::universe()
 {
     return _universe;
 }
 
+const TickScheduler& Game::scheduler() const
+{
+    return _scheduler;
+}
+
 
 const std::shared_ptr<V8ProcessorPool>& Game::processor_pool() const
 {
@@ -99,12 +128,12 @@ const std::shared_ptr<V8ProcessorPool>& Game::processor_pool() const
 
 obj_id Game::next_obj_id()
 {
-    return obj_id{_next_id()};
+    return obj_id{_objects.reserve()};
 }
 
 void Game::register_object(const obj_ptr& obj)
 {
-    _objects.emplace(obj->id(), obj);
+    _objects.assign(obj->id().value(), obj);
     _universe.add_object(obj);
 }
 
@@ -119,17 +148,64 @@ const std::shared_ptr<boost::asio::io_service>& Game::service() const
     return _service;
 }
 
+subscriptable<>& Game::on_script_round()
+{
+    return _onScriptRound;
+}
+
+subscriptable<>& Game::on_stream()
+{
+    return _onStream;
+}
+
 void Game::run()
 {
+    const unsigned long long reportTicks = _metricsReportInterval * _scheduler.tick_rate();
+    unsigned long long nextReport = reportTicks;
+
     while (true)
     {
-        _service->reset();
-        _service->run();
-
-        _universe.update(0.01f);
+        auto ticks = _scheduler.wait();
+
+        for(unsigned int i = 0; i < ticks; ++i)
+        {
+            _tick();
+        }
+
+        if(reportTicks && _scheduler.metrics().ticks >= nextReport)
+        {
+            SC_LOG(Info, Game) << "tick metrics: " << _scheduler.metrics();
+            _scheduler.reset_max();
+            nextReport += reportTicks;
+        }
+    }
+}
 
+void Game::_tick()
+{
+    using Phase = TickScheduler::Phase;
+    _scheduler.begin_tick();
+    {
+        auto timer = _scheduler.measure(Phase::Network);
+        _service->reset();
+        _service->poll();
+    }
+    {
+        auto timer = _scheduler.measure(Phase::Physics);
+        _universe.update(_scheduler.dt());
+    }
+    {
+        auto timer = _scheduler.measure(Phase::Scripting);
+        _onScriptRound.notify();
         _ppool->update_all();
     }
+    if(++_ticksSinceStream >= _streamInterval)
+    {
+        auto timer = _scheduler.measure(Phase::Streaming);
+        _ticksSinceStream = 0;
+        _onStream.notify();
+    }
+    _scheduler.end_tick();
 }
 
 
@@ -2,16 +2,33 @@
 
 #include <boost/noncopyable.hpp>
 #include <unordered_map>
+#include <algorithm>
+#include <thread>
 #include <boost/asio.hpp>
 #include "defs.hpp"
 #include "player.hpp"
 #include "fraction.hpp"
 #include "game_object.hpp"
 #include "universe.hpp"
+#include "tick_scheduler.hpp"
+#include "slot_map.hpp"
+#include "object_pool.hpp"
+#include "subscription.hpp"
+#include "scripting/script_budget.hpp"
 
 struct GameConfig
 {
     std::vector<std::string> players;
+    unsigned int simulation_threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int script_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<ScriptBudget> script_tiers{ScriptBudget{}};        // script cpu budgets, indexed by player tier
+    std::unordered_map<std::string, unsigned int> player_tiers{};   // by player name, players not listed get tier 0
+    std::string script_cache_dir{};                                 // compiled scripts are kept here, empty for memory only
+    std::size_t script_cache_mb = 64;                               // compiled scripts kept in memory, and again in script_cache_dir
+    unsigned int tick_rate = 100;               // ticks per second
+    unsigned int max_catch_up_ticks = 5;        // ticks simulated at most after falling behind
+    unsigned int metrics_report_interval = 10;  // in seconds, 0 to disable
+    unsigned int stream_rate = 20;              // world state updates per second sent to clients
 };
 
 class V8ProcessorPool;
@@ -29,13 +46,15 @@ public:
     Player& resolve_player(const player_id& id);
     Fraction& resolve_fraction(const fraction_id& id);
     obj_ptr resolve_object(const obj_id& id);
+    GameObject* find_object(const obj_id& id);
 
     Player* get_player_by_hash(const std::string& hash);
+    const ScriptBudget& script_budget(const Player& player) const;
 
     template<typename T, typename... Args>
     std::shared_ptr<T> make_object(Args&&... args)
     {
-        auto ptr = std::make_shared<T>(std::forward<Args>(args)...);
+        auto ptr = std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
         register_object(ptr);
         return ptr;
     }
@@ -45,21 +64,35 @@ public:
     void run();
 
     Universe& universe();
+    const TickScheduler& scheduler() const;
     const std::shared_ptr<V8ProcessorPool>& processor_pool() const;
     obj_id next_obj_id();
     const std::shared_ptr<boost::asio::io_service>& service() const;
+
+    // fired every tick on the game thread right before the scripts run
+    subscriptable<>& on_script_round();
+    // fired stream_rate times per second after the simulation, on the game thread
+    subscriptable<>& on_stream();
 private:
     Game(const GameConfig& config);
     
     id_value_type _next_id();
+    void _tick();
 private:
-    Universe _universe{};
+    Universe _universe;
     ResourceType _ore_type {"ore"};
     std::unordered_map<player_id, Player> _players{};
     std::unordered_map<std::string, Player*> _hashToPlayer{};
     std::unordered_map<fraction_id, Fraction> _fractions{};
-    std::unordered_map<obj_id, obj_ptr> _objects{};
+    SlotMap<obj_ptr> _objects{};
     id_value_type _nextId = 0;
     std::shared_ptr<V8ProcessorPool> _ppool;
     std::shared_ptr<boost::asio::io_service> _service;
+    TickScheduler _scheduler;
+    const unsigned int _metricsReportInterval;
+    const std::vector<ScriptBudget> _scriptTiers;
+    const unsigned int _streamInterval;         // in ticks
+    unsigned int _ticksSinceStream = 0;
+    subscriptable<> _onScriptRound{};
+    subscriptable<> _onStream{};
 };
\ No newline at end of file
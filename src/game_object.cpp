@@ -1,8 +1,8 @@
 #include "game_object.hpp"
 
 #include <cassert>
-#include <iostream>
 #include "game.hpp"
+#include "universe.hpp"
 
 obj_id::obj_id(id_value_type id)
     : proto_id(id)
@@ -14,6 +14,11 @@ obj_ptr obj_id::resolve() const
     return Game::Current().resolve_object(*this);
 }
 
+GameObject* obj_id::find() const
+{
+    return Game::Current().find_object(*this);
+}
+
 
 
 Target::Target(const vec2& target)
@@ -45,7 +50,14 @@ vec2 Target::position() const
 GameObject::GameObject(std::string name)
     : _id(Game::Current().next_obj_id())
     , _name(name + "[" + std::to_string(_id.value()) + "]")
+    , _motion(Game::Current().universe().motion())
+    , _motionHandle(_motion.allocate())
+{
+}
+
+GameObject::~GameObject()
 {
+    _motion.release(_motionHandle);
 }
 
 const obj_id& GameObject::id() const
@@ -63,19 +75,23 @@ const std::string& GameObject::name() const
 {
     assert
 }*/
-const vec2& GameObject::set_position(const vec2& pos)
+vec2 GameObject::set_position(const vec2& pos)
 {
-    return _position = pos;
+    _motion.set_position(_motionHandle, pos);
+    _moved();
+    return pos;
 }
 
-const vec2& GameObject::set_velocity(const vec2& vel)
+vec2 GameObject::set_velocity(const vec2& vel)
 {
-    return _velocity = vel;
+    _motion.set_velocity(_motionHandle, vel);
+    return vel;
 }
 
 void GameObject::set_target(const Target& target)
 {
     _target = target;
+    _motion.set_target(_motionHandle, target.position());
 }
 
 // current status
@@ -84,9 +100,9 @@ bool GameObject::activate(bool active)
     return _active = active;
 }
 
-const vec2& GameObject::position() const
+vec2 GameObject::position() const
 {
-    return _position;
+    return _motion.position(_motionHandle);
 }
 
 bool GameObject::active() const
@@ -94,9 +110,9 @@ bool GameObject::active() const
     return _active;
 }
 
-const vec2& GameObject::velocity()
+vec2 GameObject::velocity() const
 {
-    return _velocity;
+    return _motion.velocity(_motionHandle);
 }
 
 bool GameObject::has_target() const
@@ -108,6 +124,17 @@ boost::optional<Target> GameObject::target() const
     return _target;
 }
 
+bool GameObject::arrived() const
+{
+    // the motion integration snaps objects onto their target once they are slow enough
+    return _target && position() == _target->position() && velocity() == vec2();
+}
+
+Fraction* GameObject::fraction() const
+{
+    return nullptr;
+}
+
 // physic properties
 float GameObject::sight() const
 {
@@ -145,54 +172,16 @@ bool GameObject::interact_reboot()
     return false;
 }
 
+bool GameObject::interact_reload()
+{
+    return false;
+}
+
 
-void GameObject::_update(float dt)
+void GameObject::_moved()
 {
-    if(has_target())
-    {
-        auto to = target()->position();
-        auto path = to - _position;
-        if (glm::length(path) <= 0.1) {
-            if (glm::length(_velocity) <= 0.1) {
-                _position = to;
-                _velocity = vec2();
-            } else {
-                _velocity -= glm::normalize(_velocity) * std::min(glm::length(_velocity), acceleration()) * dt;
-            }
-        } else {
-            auto dir = glm::normalize(path);
-            auto optProj = glm::dot(dir, _velocity) * dir;
-            auto pathToOpt = optProj - _velocity;
-            auto pathLenToOpt = glm::length(pathToOpt) * dt;
-            auto curAcc = acceleration() * dt;
-            if (pathLenToOpt < curAcc) {
-                auto rest = curAcc - pathLenToOpt;
-                _velocity = optProj;
-                auto speed = glm::length(_velocity);
-                auto neededSecToTarget = speed > 0? glm::length(path) / speed : std::numeric_limits<float>::infinity();
-                auto secsToStop = speed / acceleration();
-                _velocity += dir * rest * (secsToStop < neededSecToTarget? 1.0f : -1.0f);
-
-            } else {
-                _velocity += glm::normalize(pathToOpt) * curAcc;
-            }
-        }
-        auto speed = glm::length(_velocity);
-        if(speed > max_speed())
-            _velocity *= max_speed() / speed;
-    } else {
-        auto speed = glm::length(_velocity);
-        auto dtAcc = dt * acceleration();
-        if(dtAcc < speed)
-        {
-            _velocity *= 1.f - (dtAcc / speed);
-        }else{
-            _velocity = vec2();
-        }
-    }
-    _position += dt * _velocity;
-    if (_velocity != vec2())
-        std::cout << name() << " at " << _position << std::endl;
+    if(_universe)
+        _universe->_on_moved(this);
 }
 
 
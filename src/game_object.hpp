@@ -1,11 +1,13 @@
 #pragma once
 
-#include <unordered_set>
+#include <cstdint>
+#include <vector>
 #include <boost/optional.hpp>
 #include <boost/noncopyable.hpp>
 #include "id.hpp"
 #include "defs.hpp"
 #include "resource_type.hpp"
+#include "motion_store.hpp"
 
 namespace detail {
     struct object_id_tag
@@ -15,6 +17,7 @@ namespace detail {
 
 class GameObject;
 class Universe;
+class Fraction;
 
 using obj_ptr = std::shared_ptr<GameObject>;
 
@@ -22,6 +25,7 @@ struct obj_id : proto_id<detail::object_id_tag>
 {
     explicit obj_id(id_value_type id);
     obj_ptr resolve() const;
+    GameObject* find() const;   // nullptr if the object does not exist (anymore)
 };
 
 MAKE_ID_HASH(obj_id);
@@ -73,25 +77,30 @@ struct MineResult
 class GameObject: boost::noncopyable
 {
     friend class Universe;
+    friend class SpatialHash;
 public:
     GameObject(std::string name);
-    virtual ~GameObject() = default;
+    virtual ~GameObject();
 
     const obj_id& id() const;
     const std::string& name() const;
 
     // controll
     bool activate(bool active = true);
-    const vec2& set_position(const vec2& pos);
-    const vec2& set_velocity(const vec2& vel);
+    vec2 set_position(const vec2& pos);
+    vec2 set_velocity(const vec2& vel);
     void set_target(const Target& target);
 
     // current status
-    const vec2& position() const;
+    vec2 position() const;
     virtual bool active() const;
-    const vec2& velocity();
+    vec2 velocity() const;
     bool has_target() const;
     boost::optional<Target> target() const;
+    bool arrived() const;       // stands still on its target
+
+    // the fraction sharing this object's vision, if any
+    virtual Fraction* fraction() const;
 
     // physic properties
     virtual float sight() const;        // in meter
@@ -109,15 +118,24 @@ public:
     virtual boost::optional<MineResult> interact_mine(unsigned int power);
     virtual bool interact_send_code(const std::string& path, const std::string& code);
     virtual bool interact_reboot();
+    // applies sent code without a reboot, false if the object can't
+    virtual bool interact_reload();
 private:
-    void _update(float dt);
+    void _moved();
 
 protected:
     const obj_id _id;
     const std::string _name;
-    vec2 _position{0, 0};       // in meter
-    vec2 _velocity{0, 0};       // in meter per second
+    MotionStore& _motion;       // position and velocity live here
+    const MotionStore::handle _motionHandle;
     boost::optional<Target> _target{};
-    std::unordered_set<obj_id> _objInSight{};
+    std::vector<std::uint32_t> _inSight{};    // sorted, see Universe::sight_ref
     bool _active = false;
+
+private:
+    // bookkeeping of the universe this object lives in
+    Universe* _universe = nullptr;
+    std::size_t _universeIndex = 0;
+    bool _dynamic = false;
+    std::uint64_t _cell = 0;
 };
@@ -0,0 +1,314 @@
+#include "log.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <iostream>
+
+namespace {
+    const std::size_t RingCapacity = 4096; // must be a power of two
+    const auto IdleSleep = std::chrono::milliseconds(2);
+
+    // bounded multi producer, single consumer ring (after Dmitry Vyukov's mpmc queue)
+    class RecordRing: boost::noncopyable
+    {
+    public:
+        RecordRing()
+            : _slots(RingCapacity)
+        {
+            static_assert((RingCapacity & (RingCapacity - 1)) == 0, "capacity must be a power of two");
+            for(std::size_t i = 0; i < RingCapacity; ++i)
+            {
+                _slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool push(const Log::Record& record)
+        {
+            Slot* slot;
+            auto pos = _enqueuePos.load(std::memory_order_relaxed);
+            while(true)
+            {
+                slot = &_slots[pos & (RingCapacity - 1)];
+                auto seq = slot->sequence.load(std::memory_order_acquire);
+                auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+                if(diff == 0)
+                {
+                    if(_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if(diff < 0)
+                {
+                    // full
+                    return false;
+                } else {
+                    pos = _enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            auto& target = slot->record;
+            target.level = record.level;
+            target.category = record.category;
+            target.length = record.length;
+            std::memcpy(target.text.data(), record.text.data(), record.length);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // only called by the writer thread
+        bool pop(Log::Record& record)
+        {
+            auto& slot = _slots[_dequeuePos & (RingCapacity - 1)];
+            if(slot.sequence.load(std::memory_order_acquire) != _dequeuePos + 1)
+                return false;
+
+            record.level = slot.record.level;
+            record.category = slot.record.category;
+            record.length = slot.record.length;
+            std::memcpy(record.text.data(), slot.record.text.data(), record.length);
+            slot.sequence.store(_dequeuePos + RingCapacity, std::memory_order_release);
+            ++_dequeuePos;
+            return true;
+        }
+
+        std::size_t pushed() const
+        {
+            return _enqueuePos.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::size_t> sequence;
+            Log::Record record;
+        };
+
+        std::vector<Slot> _slots;
+        alignas(64) std::atomic<std::size_t> _enqueuePos{0};
+        alignas(64) std::size_t _dequeuePos = 0;
+    };
+
+    // runs until the process ends, so logging works in any static destructor
+    class Writer: boost::noncopyable
+    {
+    public:
+        Writer()
+            : _thread(&Writer::run, this)
+        {
+        }
+
+        void push(const Log::Record& record)
+        {
+            if(_ring.push(record))
+                return;
+
+            if(record.level >= LogLevel::Warning)
+            {
+                // too important to drop, written ahead of the queued ones
+                std::lock_guard<std::mutex> lock(_outMutex);
+                write(record);
+                std::cerr.flush();
+            } else {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void flush()
+        {
+            auto target = _ring.pushed();
+            while(_written.load(std::memory_order_acquire) < target)
+            {
+                std::this_thread::sleep_for(IdleSleep);
+            }
+        }
+
+        unsigned long long dropped() const
+        {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void run()
+        {
+            Log::Record record;
+            unsigned long long reported = 0;
+            while(true)
+            {
+                std::size_t count = 0;
+                {
+                    std::lock_guard<std::mutex> lock(_outMutex);
+                    while(_ring.pop(record))
+                    {
+                        write(record);
+                        ++count;
+                    }
+
+                    auto dropped = _dropped.load(std::memory_order_relaxed);
+                    if(dropped != reported)
+                    {
+                        std::cerr << "[warning][log] " << (dropped - reported) << " log messages were dropped\n";
+                        reported = dropped;
+                        std::cerr.flush();
+                    }
+
+                    if(count)
+                    {
+                        std::cout.flush();
+                        std::cerr.flush();
+                    }
+                }
+
+                if(count)
+                    _written.fetch_add(count, std::memory_order_release);
+                else
+                    std::this_thread::sleep_for(IdleSleep);
+            }
+        }
+
+        static void write(const Log::Record& record)
+        {
+            auto& out = record.level >= LogLevel::Warning? std::cerr : std::cout;
+            out << '[' << to_string(record.level) << "][" << to_string(record.category) << "] ";
+            out.write(record.text.data(), record.length);
+            out << '\n';
+        }
+
+    private:
+        RecordRing _ring;
+        std::mutex _outMutex;       // orders the writer thread and direct writes
+        std::atomic<std::size_t> _written{0};
+        std::atomic<unsigned long long> _dropped{0};
+        std::thread _thread;
+    };
+
+    Writer& writer()
+    {
+        // never destroyed, static destructors and atexit handlers may still log.
+        // Placed in static storage, new does not align to the ring's 64 bytes before C++17.
+        static std::aligned_storage<sizeof(Writer), alignof(Writer)>::type storage;
+        static auto instance = new(&storage) Writer();
+        return *instance;
+    }
+}
+
+
+const char* to_string(LogLevel level)
+{
+    switch(level)
+    {
+    case LogLevel::Trace:
+        return "trace";
+    case LogLevel::Debug:
+        return "debug";
+    case LogLevel::Info:
+        return "info";
+    case LogLevel::Warning:
+        return "warning";
+    case LogLevel::Error:
+        return "error";
+    default:
+        return "off";
+    }
+}
+
+const char* to_string(LogCategory category)
+{
+    switch(category)
+    {
+    case LogCategory::Game:
+        return "game";
+    case LogCategory::Universe:
+        return "universe";
+    case LogCategory::Server:
+        return "server";
+    case LogCategory::Scripting:
+        return "scripting";
+    default:
+        return "unknown";
+    }
+}
+
+
+Log::Line::Buffer::Buffer(Record& record)
+    : record(record)
+{
+}
+
+Log::Line::Buffer::int_type Log::Line::Buffer::overflow(int_type ch)
+{
+    if(ch != traits_type::eof() && record.length < MaxMessageLength)
+    {
+        record.text[record.length++] = traits_type::to_char_type(ch);
+    }
+    // too long messages get truncated
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize Log::Line::Buffer::xsputn(const char* s, std::streamsize n)
+{
+    auto count = std::min<std::size_t>(std::size_t(n), MaxMessageLength - record.length);
+    std::memcpy(record.text.data() + record.length, s, count);
+    record.length += count;
+    return n;
+}
+
+Log::Line::Line(LogLevel level, LogCategory category)
+    : _record{level, category, 0, {}}
+    , _buffer(_record)
+    , _stream(&_buffer)
+{
+}
+
+Log::Line::~Line()
+{
+    writer().push(_record);
+}
+
+std::ostream& Log::Line::stream()
+{
+    return _stream;
+}
+
+
+std::array<std::atomic<LogLevel>, std::size_t(LogCategory::Count)> Log::_levels{{
+    {LogLevel::Info},
+    {LogLevel::Info},
+    {LogLevel::Info},
+    {LogLevel::Info}
+}};
+static_assert(std::size_t(LogCategory::Count) == 4, "initialize the level of every category");
+
+void Log::set_level(LogCategory category, LogLevel level)
+{
+    assert(category < LogCategory::Count);
+    _levels[std::size_t(category)].store(level, std::memory_order_relaxed);
+}
+
+void Log::set_level(LogLevel level)
+{
+    for(auto& l : _levels)
+    {
+        l.store(level, std::memory_order_relaxed);
+    }
+}
+
+LogLevel Log::level(LogCategory category)
+{
+    return _levels[std::size_t(category)].load(std::memory_order_relaxed);
+}
+
+unsigned long long Log::dropped()
+{
+    return writer().dropped();
+}
+
+void Log::flush()
+{
+    writer().flush();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <streambuf>
+#include <boost/noncopyable.hpp>
+
+enum class LogLevel
+{
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+enum class LogCategory
+{
+    Game,
+    Universe,
+    Server,
+    Scripting,
+    Count
+};
+
+const char* to_string(LogLevel level);
+const char* to_string(LogCategory category);
+
+// Asynchronous logger.
+// Messages are formatted on the calling thread into a fixed size record and
+// handed to a background writer through a lock-free ring, so logging never
+// allocates or blocks the caller. If the ring is full, warnings and errors
+// are written by the caller instead, other messages are dropped, counted and
+// the count is logged. Use the SC_LOG macro, which costs a single atomic
+// load if the level is disabled for the category.
+class Log: boost::noncopyable
+{
+public:
+    static constexpr std::size_t MaxMessageLength = 256;
+
+    struct Record
+    {
+        LogLevel level;
+        LogCategory category;
+        std::size_t length;
+        std::array<char, MaxMessageLength> text;
+    };
+
+    // formats one message and pushes it on destruction
+    class Line: boost::noncopyable
+    {
+    public:
+        Line(LogLevel level, LogCategory category);
+        ~Line();
+
+        std::ostream& stream();
+
+    private:
+        struct Buffer: std::streambuf
+        {
+            Buffer(Record& record);
+            int_type overflow(int_type ch) override;
+            std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+            Record& record;
+        };
+
+        Record _record;
+        Buffer _buffer;
+        std::ostream _stream;
+    };
+
+public:
+    static bool enabled(LogLevel level, LogCategory category)
+    {
+        return level >= _levels[std::size_t(category)].load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogCategory category, LogLevel level);
+    static void set_level(LogLevel level);
+    static LogLevel level(LogCategory category);
+
+    static unsigned long long dropped();
+
+    // turns the stream expression of SC_LOG into void, & binds weaker than <<
+    struct Voidify
+    {
+        void operator&(std::ostream&) {}
+    };
+
+    // Blocks until everything pushed so far is written.
+    // The writer is never stopped, call this before the process exits.
+    static void flush();
+
+private:
+    static std::array<std::atomic<LogLevel>, std::size_t(LogCategory::Count)> _levels;
+};
+
+// a single expression, so it can be used like any other statement, e.g. under an unbraced if
+#define SC_LOG(level, category) \
+    !::Log::enabled(::LogLevel::level, ::LogCategory::category) ? (void)0 \
+        : ::Log::Voidify() & ::Log::Line(::LogLevel::level, ::LogCategory::category).stream()
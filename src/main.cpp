@@ -1,5 +1,6 @@
 #include "game.hpp"
 #include "server/server.hpp"
+#include "log.hpp"
 
 #include <iostream>
 #include <thread>
@@ -7,7 +8,7 @@
 using namespace std;
 
 #if 1
-#if !defined(STARCODE_TEST)
+#if !defined(STARCODE_TEST) && !defined(STARCODE_BENCH)
 int main()
 {
     GameConfig config {
@@ -18,10 +19,11 @@ int main()
     auto server = Server::create();
     server->start(8080);
 
-    std::cout << "start" << std::endl;
+    SC_LOG(Info, Game) << "start";
     game.run();
 
     Game::Shutdown();
+    Log::flush();
     return 0;
 }
 #endif
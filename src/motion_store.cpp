@@ -0,0 +1,301 @@
+#include "motion_store.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const std::uint32_t LaneSet = ~std::uint32_t(0);
+
+    // the steering code compared lengths as "<= 0.1" in double precision,
+    // which for floats is the same as "< 0.1f"
+    const float ArrivalThreshold = 0.1f;
+}
+
+MotionStore::handle MotionStore::allocate()
+{
+    if(_free.size())
+    {
+        auto h = _free.back();
+        _free.pop_back();
+        return h;
+    }
+
+    auto h = handle(_px.size());
+    _px.push_back(0.0f);
+    _py.push_back(0.0f);
+    _vx.push_back(0.0f);
+    _vy.push_back(0.0f);
+    _tx.push_back(0.0f);
+    _ty.push_back(0.0f);
+    _acc.push_back(0.0f);
+    _maxSpeed.push_back(0.0f);
+    _hasTarget.push_back(0);
+    _dynamic.push_back(0);
+    return h;
+}
+
+void MotionStore::release(handle h)
+{
+    assert(h < size());
+    _px[h] = _py[h] = 0.0f;
+    _vx[h] = _vy[h] = 0.0f;
+    _hasTarget[h] = 0;
+    _dynamic[h] = 0;
+    _free.push_back(h);
+}
+
+vec2 MotionStore::position(handle h) const
+{
+    return vec2(_px[h], _py[h]);
+}
+
+void MotionStore::set_position(handle h, const vec2& pos)
+{
+    _px[h] = pos.x;
+    _py[h] = pos.y;
+}
+
+vec2 MotionStore::velocity(handle h) const
+{
+    return vec2(_vx[h], _vy[h]);
+}
+
+void MotionStore::set_velocity(handle h, const vec2& vel)
+{
+    _vx[h] = vel.x;
+    _vy[h] = vel.y;
+}
+
+void MotionStore::set_target(handle h, const vec2& target)
+{
+    _tx[h] = target.x;
+    _ty[h] = target.y;
+    _hasTarget[h] = LaneSet;
+}
+
+void MotionStore::set_dynamic(handle h, bool dynamic)
+{
+    _dynamic[h] = dynamic? LaneSet : 0;
+}
+
+void MotionStore::set_limits(handle h, float acceleration, float maxSpeed)
+{
+    _acc[h] = acceleration;
+    _maxSpeed[h] = maxSpeed;
+}
+
+std::size_t MotionStore::size() const
+{
+    return _px.size();
+}
+
+void MotionStore::integrate(float dt)
+{
+    integrate(dt, 0, size());
+}
+
+void MotionStore::integrate(float dt, std::size_t begin, std::size_t end)
+{
+    assert(begin <= end && end <= size());
+    std::size_t i = begin;
+
+#if defined(__SSE2__)
+    // Same operations in the same order as integrate_scalar, evaluated for
+    // all branches and blended by masks. Results are bit identical.
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 threshold = _mm_set1_ps(ArrivalThreshold);
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+
+    auto sel = [](__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    };
+    auto len = [](__m128 x, __m128 y)
+    {
+        return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    };
+    auto mask = [](const std::uint32_t* p)
+    {
+        return _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    };
+
+    for(; i + 4 <= end; i += 4)
+    {
+        const __m128 px = _mm_loadu_ps(&_px[i]);
+        const __m128 py = _mm_loadu_ps(&_py[i]);
+        const __m128 vx = _mm_loadu_ps(&_vx[i]);
+        const __m128 vy = _mm_loadu_ps(&_vy[i]);
+        const __m128 tx = _mm_loadu_ps(&_tx[i]);
+        const __m128 ty = _mm_loadu_ps(&_ty[i]);
+        const __m128 acc = _mm_loadu_ps(&_acc[i]);
+        const __m128 maxSpeed = _mm_loadu_ps(&_maxSpeed[i]);
+        const __m128 hasTarget = mask(&_hasTarget[i]);
+        const __m128 dynamic = mask(&_dynamic[i]);
+
+        const __m128 speed = len(vx, vy);
+
+        // with target
+        const __m128 pathx = _mm_sub_ps(tx, px);
+        const __m128 pathy = _mm_sub_ps(ty, py);
+        const __m128 pathLen = len(pathx, pathy);
+        const __m128 arrived = _mm_cmplt_ps(pathLen, threshold);
+        const __m128 stopped = _mm_cmplt_ps(speed, threshold);
+        const __m128 snap = _mm_and_ps(arrived, stopped);
+
+        // arrived, but still moving: brake
+        const __m128 invSpeed = _mm_div_ps(one, speed);
+        const __m128 brake = _mm_min_ps(acc, speed);
+        const __m128 brakex = _mm_sub_ps(vx, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(vx, invSpeed), brake), vdt));
+        const __m128 brakey = _mm_sub_ps(vy, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(vy, invSpeed), brake), vdt));
+
+        // on the way: steer towards the optimal path
+        const __m128 invPathLen = _mm_div_ps(one, pathLen);
+        const __m128 dirx = _mm_mul_ps(pathx, invPathLen);
+        const __m128 diry = _mm_mul_ps(pathy, invPathLen);
+        const __m128 proj = _mm_add_ps(_mm_mul_ps(dirx, vx), _mm_mul_ps(diry, vy));
+        const __m128 optx = _mm_mul_ps(proj, dirx);
+        const __m128 opty = _mm_mul_ps(proj, diry);
+        const __m128 toOptx = _mm_sub_ps(optx, vx);
+        const __m128 toOpty = _mm_sub_ps(opty, vy);
+        const __m128 toOptLen = len(toOptx, toOpty);
+        const __m128 pathLenToOpt = _mm_mul_ps(toOptLen, vdt);
+        const __m128 curAcc = _mm_mul_ps(acc, vdt);
+        const __m128 onOpt = _mm_cmplt_ps(pathLenToOpt, curAcc);
+
+        const __m128 rest = _mm_sub_ps(curAcc, pathLenToOpt);
+        const __m128 optSpeed = len(optx, opty);
+        const __m128 neededSecToTarget = sel(_mm_cmpgt_ps(optSpeed, zero), _mm_div_ps(pathLen, optSpeed), inf);
+        const __m128 secsToStop = _mm_div_ps(optSpeed, acc);
+        const __m128 sign = sel(_mm_cmplt_ps(secsToStop, neededSecToTarget), one, minusOne);
+        const __m128 onOptx = _mm_add_ps(optx, _mm_mul_ps(_mm_mul_ps(dirx, rest), sign));
+        const __m128 onOpty = _mm_add_ps(opty, _mm_mul_ps(_mm_mul_ps(diry, rest), sign));
+
+        const __m128 invToOptLen = _mm_div_ps(one, toOptLen);
+        const __m128 toOptVelx = _mm_add_ps(vx, _mm_mul_ps(_mm_mul_ps(toOptx, invToOptLen), curAcc));
+        const __m128 toOptVely = _mm_add_ps(vy, _mm_mul_ps(_mm_mul_ps(toOpty, invToOptLen), curAcc));
+
+        __m128 tvx = sel(arrived, sel(stopped, zero, brakex), sel(onOpt, onOptx, toOptVelx));
+        __m128 tvy = sel(arrived, sel(stopped, zero, brakey), sel(onOpt, onOpty, toOptVely));
+
+        const __m128 targetSpeed = len(tvx, tvy);
+        const __m128 tooFast = _mm_cmpgt_ps(targetSpeed, maxSpeed);
+        const __m128 limit = _mm_div_ps(maxSpeed, targetSpeed);
+        tvx = sel(tooFast, _mm_mul_ps(tvx, limit), tvx);
+        tvy = sel(tooFast, _mm_mul_ps(tvy, limit), tvy);
+
+        // without target: slow down
+        const __m128 dtAcc = _mm_mul_ps(vdt, acc);
+        const __m128 slowing = _mm_cmplt_ps(dtAcc, speed);
+        const __m128 factor = _mm_sub_ps(one, _mm_div_ps(dtAcc, speed));
+        const __m128 fvx = sel(slowing, _mm_mul_ps(vx, factor), zero);
+        const __m128 fvy = sel(slowing, _mm_mul_ps(vy, factor), zero);
+
+        const __m128 nvx = sel(hasTarget, tvx, fvx);
+        const __m128 nvy = sel(hasTarget, tvy, fvy);
+        __m128 npx = sel(_mm_and_ps(hasTarget, snap), tx, px);
+        __m128 npy = sel(_mm_and_ps(hasTarget, snap), ty, py);
+        npx = _mm_add_ps(npx, _mm_mul_ps(vdt, nvx));
+        npy = _mm_add_ps(npy, _mm_mul_ps(vdt, nvy));
+
+        _mm_storeu_ps(&_px[i], sel(dynamic, npx, px));
+        _mm_storeu_ps(&_py[i], sel(dynamic, npy, py));
+        _mm_storeu_ps(&_vx[i], sel(dynamic, nvx, vx));
+        _mm_storeu_ps(&_vy[i], sel(dynamic, nvy, vy));
+    }
+#endif
+
+    for(; i < end; ++i)
+    {
+        if(_dynamic[i])
+            integrate_scalar(dt, i);
+    }
+}
+
+void MotionStore::integrate_scalar(float dt, std::size_t i)
+{
+    float px = _px[i], py = _py[i];
+    float vx = _vx[i], vy = _vy[i];
+    const float acc = _acc[i];
+    const float maxSpeed = _maxSpeed[i];
+
+    auto len = [](float x, float y)
+    {
+        return std::sqrt(x * x + y * y);
+    };
+
+    if(_hasTarget[i])
+    {
+        const float tx = _tx[i], ty = _ty[i];
+        const float pathx = tx - px, pathy = ty - py;
+        const float pathLen = len(pathx, pathy);
+        if (pathLen < ArrivalThreshold) {
+            const float speed = len(vx, vy);
+            if (speed < ArrivalThreshold) {
+                px = tx;
+                py = ty;
+                vx = vy = 0.0f;
+            } else {
+                const float invSpeed = 1.0f / speed;
+                const float brake = std::min(speed, acc);
+                vx -= vx * invSpeed * brake * dt;
+                vy -= vy * invSpeed * brake * dt;
+            }
+        } else {
+            const float invPathLen = 1.0f / pathLen;
+            const float dirx = pathx * invPathLen, diry = pathy * invPathLen;
+            const float proj = dirx * vx + diry * vy;
+            const float optx = proj * dirx, opty = proj * diry;
+            const float toOptx = optx - vx, toOpty = opty - vy;
+            const float toOptLen = len(toOptx, toOpty);
+            const float pathLenToOpt = toOptLen * dt;
+            const float curAcc = acc * dt;
+            if (pathLenToOpt < curAcc) {
+                const float rest = curAcc - pathLenToOpt;
+                vx = optx;
+                vy = opty;
+                const float speed = len(vx, vy);
+                const float neededSecToTarget = speed > 0? pathLen / speed : std::numeric_limits<float>::infinity();
+                const float secsToStop = speed / acc;
+                const float sign = secsToStop < neededSecToTarget? 1.0f : -1.0f;
+                vx += dirx * rest * sign;
+                vy += diry * rest * sign;
+            } else {
+                const float invToOptLen = 1.0f / toOptLen;
+                vx += toOptx * invToOptLen * curAcc;
+                vy += toOpty * invToOptLen * curAcc;
+            }
+        }
+        const float speed = len(vx, vy);
+        if(speed > maxSpeed)
+        {
+            const float limit = maxSpeed / speed;
+            vx *= limit;
+            vy *= limit;
+        }
+    } else {
+        const float speed = len(vx, vy);
+        const float dtAcc = dt * acc;
+        if(dtAcc < speed)
+        {
+            const float factor = 1.f - (dtAcc / speed);
+            vx *= factor;
+            vy *= factor;
+        }else{
+            vx = vy = 0.0f;
+        }
+    }
+
+    _px[i] = px + dt * vx;
+    _py[i] = py + dt * vy;
+    _vx[i] = vx;
+    _vy[i] = vy;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "defs.hpp"
+
+// Structure-of-arrays storage for everything the movement integration needs.
+// Game objects only keep a handle into it, so the integrator can run over
+// contiguous float arrays instead of chasing object pointers.
+class MotionStore: boost::noncopyable
+{
+public:
+    using handle = std::uint32_t;
+
+    handle allocate();
+    void release(handle h);
+
+    vec2 position(handle h) const;
+    void set_position(handle h, const vec2& pos);
+    vec2 velocity(handle h) const;
+    void set_velocity(handle h, const vec2& vel);
+    void set_target(handle h, const vec2& target);
+
+    void set_dynamic(handle h, bool dynamic);
+    void set_limits(handle h, float acceleration, float maxSpeed);
+
+    std::size_t size() const;
+
+    // integrates all dynamic slots in [begin, end)
+    void integrate(float dt);
+    void integrate(float dt, std::size_t begin, std::size_t end);
+
+private:
+    void integrate_scalar(float dt, std::size_t i);
+
+private:
+    std::vector<float> _px{}, _py{};        // in meter
+    std::vector<float> _vx{}, _vy{};        // in meter per second
+    std::vector<float> _tx{}, _ty{};        // target in meter
+    std::vector<float> _acc{};              // in meter per second^2
+    std::vector<float> _maxSpeed{};         // in meter per second
+    // lane masks, either all bits set or zero
+    std::vector<std::uint32_t> _hasTarget{};
+    std::vector<std::uint32_t> _dynamic{};
+
+    std::vector<handle> _free{};
+};
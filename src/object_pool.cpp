@@ -0,0 +1,63 @@
+#include "object_pool.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+namespace {
+    std::size_t round_up(std::size_t size, std::size_t align)
+    {
+        return (size + align - 1) / align * align;
+    }
+}
+
+FixedPool::FixedPool(std::size_t blockSize, std::size_t blocksPerChunk)
+    : _blockSize(round_up(std::max(blockSize, sizeof(FreeBlock)), alignof(std::max_align_t)))
+    , _blocksPerChunk(blocksPerChunk)
+{
+    assert(blocksPerChunk > 0);
+}
+
+void* FixedPool::allocate()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!_free)
+        grow();
+
+    auto block = _free;
+    _free = block->next;
+    return block;
+}
+
+void FixedPool::deallocate(void* block)
+{
+    assert(block);
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = _free;
+    _free = freeBlock;
+}
+
+std::size_t FixedPool::block_size() const
+{
+    return _blockSize;
+}
+
+std::size_t FixedPool::capacity() const
+{
+    return _chunks.size() * _blocksPerChunk;
+}
+
+void FixedPool::grow()
+{
+    // new[] of char is aligned for every fundamental type
+    std::unique_ptr<char[]> chunk(new char[_blockSize * _blocksPerChunk]);
+
+    // link backwards, so blocks are handed out in address order
+    for(std::size_t i = _blocksPerChunk; i-- > 0;)
+    {
+        auto block = reinterpret_cast<FreeBlock*>(chunk.get() + i * _blockSize);
+        block->next = _free;
+        _free = block;
+    }
+    _chunks.push_back(std::move(chunk));
+}
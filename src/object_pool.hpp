@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+// Pool of equally sized blocks, carved out of big chunks.
+// Allocation and deallocation pop/push a free list; only growing the pool
+// by another chunk goes to the global allocator. Chunks are never returned.
+class FixedPool: boost::noncopyable
+{
+public:
+    FixedPool(std::size_t blockSize, std::size_t blocksPerChunk);
+
+    void* allocate();
+    void deallocate(void* block);
+
+    std::size_t block_size() const;
+    std::size_t capacity() const;
+
+private:
+    void grow();
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    const std::size_t _blockSize;
+    const std::size_t _blocksPerChunk;
+    std::mutex _mutex;
+    FreeBlock* _free = nullptr;
+    std::vector<std::unique_ptr<char[]>> _chunks{};
+};
+
+// Allocator handing out single objects from one pool per type, so objects of
+// the same type end up next to each other. Meant for std::allocate_shared,
+// which puts object and control block into one pooled block.
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    static constexpr std::size_t BlocksPerChunk = 256;
+
+    PoolAllocator() = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if(n != 1)
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(pool().allocate());
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if(n != 1)
+        {
+            ::operator delete(p);
+        } else {
+            pool().deallocate(p);
+        }
+    }
+
+    static FixedPool& pool()
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned types are not supported");
+        // intentionally leaked, objects may be released during static destruction
+        static FixedPool* instance = new FixedPool(sizeof(T), BlocksPerChunk);
+        return *instance;
+    }
+};
+
+template<typename T, typename U>
+bool operator ==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return true;
+}
+
+template<typename T, typename U>
+bool operator !=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return false;
+}
@@ -1,20 +1,196 @@
 #include "filesystem.hpp"
 
 
-#include <regex>
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
 #include <stdexcept>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
+#include <functional>
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
+#include <boost/container/small_vector.hpp>
+
+namespace {
+    using semver = std::array<unsigned int, 3>;
+
+    bool is_digit(const std::string& s, std::string::size_type pos)
+    {
+        return pos < s.size() && std::isdigit(static_cast<unsigned char>(s[pos]));
+    }
+
+    // reads up to 9 digits
+    unsigned int read_number(const std::string& s, std::string::size_type& pos)
+    {
+        unsigned int result = 0;
+        for(int i = 0; i < 9 && is_digit(s, pos); ++i, ++pos)
+        {
+            result = result * 10 + (s[pos] - '0');
+        }
+        return result;
+    }
+
+    // Calls f(lookup, version) for every semver lookup that finds name.
+    // name is split into prefix, version and suffix at every position a
+    // version can start, i.e. where "[.]major[.minor][.patch]" can be read,
+    // and is found by "prefix^suffix". The prefix can't contain a '^'.
+    template<typename F>
+    void for_each_version(const std::string& name, F f)
+    {
+        for(std::string::size_type begin = 0; begin < name.size() && name[begin] != '^'; ++begin)
+        {
+            auto pos = begin;
+            if(name[pos] == '.')
+                ++pos;
+            if(!is_digit(name, pos))
+                continue;
+
+            semver ver = {0, 0, 0};
+            ver[0] = read_number(name, pos);
+            for(int i = 1; i < 3 && name.size() > pos && name[pos] == '.' && is_digit(name, pos + 1); ++i)
+            {
+                ++pos;
+                ver[i] = read_number(name, pos);
+            }
+
+            f(name.substr(0, begin) + '^' + name.substr(pos), ver);
+        }
+    }
+
+    // Blobs by the hash of their content. The table only holds weak
+    // references, the last file using a blob removes it from the table.
+    class BlobTable
+    {
+    public:
+        static BlobTable& Instance()
+        {
+            // never destroyed, blobs may outlive static destruction
+            static auto table = new BlobTable();
+            return *table;
+        }
+
+        FileSystem::Blob intern(std::string content)
+        {
+            auto hash = std::hash<std::string>()(content);
+            // Blobs looked at can be the last reference once they are locked.
+            // They are released after the lock, releasing takes it again.
+            std::vector<FileSystem::Blob> seen;
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& bucket = _blobs[hash];
+            for(auto& weak : bucket)
+            {
+                seen.push_back(weak.lock());
+                if(seen.back() && *seen.back() == content)
+                    return seen.back();
+            }
+
+            FileSystem::Blob blob(new std::string(std::move(content)), [this, hash](const std::string* blob)
+            {
+                delete blob;
+                release(hash);
+            });
+            bucket.push_back(blob);
+            return blob;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::size_t result = 0;
+            for(auto& bucket : _blobs)
+            {
+                result += bucket.second.size();
+            }
+            return result;
+        }
+
+    private:
+        void release(std::size_t hash)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _blobs.find(hash);
+            if(it == _blobs.end())
+            {
+                // another blob of this bucket removed all expired ones already
+                return;
+            }
+            auto& bucket = it->second;
+            bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [](const std::weak_ptr<const std::string>& weak)
+            {
+                return weak.expired();
+            }), bucket.end());
+            if(bucket.empty())
+                _blobs.erase(it);
+        }
+
+    private:
+        mutable std::mutex _mutex;
+        std::unordered_map<std::size_t, std::vector<std::weak_ptr<const std::string>>> _blobs;
+    };
+
+    // Called before a node is changed in place because use_count() was 1.
+    // use_count() is a relaxed load, the fence orders the change after the
+    // release of the last other reference, and so after every read of the
+    // node in the thread that held it.
+    void owned_exclusively()
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    // enough for any sane path, deeper ones allocate
+    using path_comps = boost::container::small_vector<boost::string_view, 16>;
+
+    // appends the components of path (dir1/dir2/file.ext -> [dir1, dir2, file.ext]),
+    // ".." removes the last one, empty ones are skipped
+    void split_path(boost::string_view path, path_comps& comps)
+    {
+        while(!path.empty())
+        {
+            auto end = path.find('/');
+            auto comp = path.substr(0, end);
+            path.remove_prefix(end == boost::string_view::npos ? path.size() : end + 1);
+
+            if(comp == "..")
+            {
+                if(comps.size())
+                    comps.pop_back();
+            } else if(!comp.empty() && comp != ".")
+            {
+                comps.push_back(comp);
+            }
+        }
+    }
+
+    // the components of file, relative to cwd unless it starts with '/'
+    path_comps resolve_path(boost::string_view cwd, boost::string_view file)
+    {
+        path_comps comps;
+        if(file.empty() || file.front() != '/')
+            split_path(cwd, comps);
+        split_path(file, comps);
+        return comps;
+    }
+}
 
 /////////////////////////////////////// FileSystem::CodeEntity ///////////////////////////////////////
+FileSystem::CodeEntity::CodeEntity(Blob code)
+    : _code(std::move(code))
+{
+    assert(_code);
+}
+
 FSType FileSystem::CodeEntity::type() const
 {
     return FSType::CodeFile;
 }
 
 const std::string& FileSystem::CodeEntity::code() const
+{
+    return *_code;
+}
+
+const FileSystem::Blob& FileSystem::CodeEntity::blob() const
 {
     return _code;
 }
@@ -29,214 +205,208 @@ FSType FileSystem::DirEntity::type() const
     return FSType::Directory;
 }
 
-FileSystem::DirEntity* FileSystem::DirEntity::as_dir()
+
+const FileSystem::DirEntity::entity_map::value_type* FileSystem::DirEntity::entry(boost::string_view file, bool wantdir) const
 {
-    return this;
+    auto it = find(*this, file, wantdir);
+    return it != _content.end() ? &*it : nullptr;
 }
 
 
-FileSystem::Entity* FileSystem::DirEntity::entity(const std::string& file, bool wantdir, bool createdir)
+FileSystem::DirEntity* FileSystem::DirEntity::mutable_dir(boost::string_view file, bool createdir)
 {
-    auto it = entity(file, wantdir);
+    auto it = find(*this, file, true);
     if(it == _content.end())
     {
-        if(createdir)
-        {
-            auto newdir = std::make_unique<DirEntity>();
-            std::tie(it, std::ignore) = _content.emplace(file, std::move(newdir));
-        }else{
+        if(!createdir)
             return nullptr;
-        }
+        it = emplace(file.to_string(), std::make_shared<DirEntity>());
     }
-    return it->second.get();
+
+    if(it->second->type() != FSType::Directory)
+        return nullptr;
+
+    if(it->second.use_count() > 1)
+    {
+        // shared with another tree, from here on this one gets its own
+        it->second = std::make_shared<DirEntity>(static_cast<const DirEntity&>(*it->second));
+    } else {
+        owned_exclusively();
+    }
+    return static_cast<DirEntity*>(it->second.get());
 }
 
 
-FileSystem::Entity* FileSystem::DirEntity::new_file(std::string file)
+FileSystem::Entity* FileSystem::DirEntity::new_file(boost::string_view file, Blob code)
 {
-    auto it = entity(file, false);
+    auto it = find(*this, file, false);
+    if(it == _content.end())
+    {
+        // a version lookup that found nothing, but names an entry itself
+        it = _content.find(file, NameHash(), NameEqual());
+    }
 
     if(it != _content.end())
     {
         if(it->second->type() == FSType::Directory)
         {
-            throw std::runtime_error("can not override directory '" + file + "'with file");
+            throw std::runtime_error("can not override directory '" + file.to_string() + "'with file");
         }
 
-        file = it->first;
-        _content.erase(it);
+        // keeps the name and its versions
+        it->second = std::make_shared<CodeEntity>(std::move(code));
+        return it->second.get();
     }
 
-    auto newdir = std::make_unique<CodeEntity>();
-    std::tie(it, std::ignore) = _content.emplace(file, std::move(newdir));
-    return it->second.get();
+    return emplace(file.to_string(), std::make_shared<CodeEntity>(std::move(code)))->second.get();
 }
 
-void FileSystem::DirEntity::erase(const std::string& file)
+void FileSystem::DirEntity::erase(boost::string_view file)
 {
-    auto it = entity(file, false);
+    auto it = find(*this, file, false);
     if(it == _content.end())
-        throw std::runtime_error("'" + file + "' does not exist to delete it");
-    _content.erase(it);
+        throw std::runtime_error("'" + file.to_string() + "' does not exist to delete it");
+    remove(it);
 }
 
-FileSystem::DirEntity::entity_map::iterator FileSystem::DirEntity::entity(const std::string& file, bool wantdir)
+template<typename Self>
+auto FileSystem::DirEntity::find(Self& self, boost::string_view file, bool wantdir) -> decltype(self._content.begin())
 {
-    auto verpos = file.find('^');
-    if(verpos != std::string::npos)
-    {
-        // semver... we have to search all
-        return semvered_entity(file, verpos, wantdir);
-    }
+    if(file.find('^') != std::string::npos)
+        return semvered_entity(self, file, wantdir);
 
-    return _content.find(file);
+    return self._content.find(file, NameHash(), NameEqual());
 }
 
 
-FileSystem::DirEntity::entity_map::iterator FileSystem::DirEntity::semvered_entity(const std::string& file, std::string::size_type verpos, bool wantdir)
+template<typename Self>
+auto FileSystem::DirEntity::semvered_entity(Self& self, boost::string_view file, bool wantdir) -> decltype(self._content.begin())
 {
-    using semver = std::array<unsigned int, 3>;
-    std::string surfix = file.substr(verpos + 1);
-    std::regex semregex("^(\\.?(\\d{1,9}))(\\.(\\d{1,9}))?(\\.(\\d{1,9}))?(.*)$");
-
-    semver maxver = {0, 0, 0};
-    auto maxentity = _content.end();
+    auto versions = self._versions.find(file, NameHash(), NameEqual());
+    if(versions == self._versions.end())
+        return self._content.end();
 
-    for(auto it = _content.begin(); it != _content.end(); ++it)
+    // highest version first
+    for(auto ver = versions->second.rbegin(); ver != versions->second.rend(); ++ver)
     {
-        auto& entry_name = it->first;
-        auto* entry = it->second.get();
-
+        auto it = self._content.find(ver->second);
+        assert(it != self._content.end());
         // check if it is a dir, if only dirs are wanted
-        if(wantdir && entry->type() != FSType::Directory)
-            continue;
-
-        // check prefix
-        bool prefix_matches = entry_name.compare(0, verpos, file, 0, verpos) == 0;
-        if(!prefix_matches)
-            continue;
-
-        auto begin = entry_name.cbegin() + verpos;
-        auto end = entry_name.cend();
-        
-        std::smatch match;
-        if(!std::regex_match(begin, end, match, semregex))
-            continue;
-        
-        // check if surfix matches
-        auto& surfix_match = *(match.end() - 1);
-        if(surfix_match.compare(surfix) != 0)
-            continue;
-        
-        // read semver
-        semver ver = {0, 0, 0};
-        int v = 0;
-        for(int i = 2; i < match.size() - 1; i += 2)
-        {
-            auto str = match.str(i);
-            if(match.length(i))
-            {
-                ver[v++] = boost::lexical_cast<unsigned int>(str);
-            }
-        }
+        if(!wantdir || it->second->type() == FSType::Directory)
+            return it;
+    }
+    return self._content.end();
+}
 
-        // maxentity && !(maxver < ver) === maxver >= ver
-        assert(maxver != ver);
-        if(maxentity != _content.end() && !std::lexicographical_compare(maxver.begin(), maxver.end(), ver.begin(), ver.end()))
-            continue;
+FileSystem::DirEntity::entity_map::iterator FileSystem::DirEntity::emplace(const std::string& file, std::shared_ptr<Entity> entity)
+{
+    entity_map::iterator it;
+    bool inserted;
+    std::tie(it, inserted) = _content.emplace(file, std::move(entity));
+    if(!inserted)
+        return it;
 
-        maxver = ver;
-        maxentity = it;
-    }
-    return maxentity;
+    for_each_version(file, [this, &file](std::string lookup, const semver& ver)
+    {
+        _versions[std::move(lookup)].emplace(ver, file);
+    });
+    return it;
+}
+
+void FileSystem::DirEntity::remove(entity_map::iterator it)
+{
+    auto& file = it->first;
+    for_each_version(file, [this, &file](const std::string& lookup, const semver& ver)
+    {
+        auto versions = _versions.find(lookup);
+        assert(versions != _versions.end());
+        versions->second.erase(std::make_pair(ver, file));
+        if(versions->second.empty())
+            _versions.erase(versions);
+    });
+    _content.erase(it);
 }
 
 
 /////////////////////////////////////// FileSystem ///////////////////////////////////////
 FileSystem::FileSystem()
 {
+    static const auto empty = std::make_shared<DirEntity>();
+    _root = empty;
 }
 
 FileSystem::~FileSystem()
 {
 }
 
-bool FileSystem::exists(const std::string& cwd, const std::string& path)
+bool FileSystem::exists(boost::string_view cwd, boost::string_view path) const
 {
     return entity(cwd, path) != nullptr;
 }
 
-FSType FileSystem::type(const std::string& cwd, const std::string& path)
+FSType FileSystem::type(boost::string_view cwd, boost::string_view path) const
 {
     return entity_checked(cwd, path)->type();
 }
 
-FileSystem::Entity* FileSystem::write(const std::string& cwd, const std::string& path, std::string content)
+FileSystem::Entity* FileSystem::write(boost::string_view cwd, boost::string_view path, std::string content)
 {
-    Entity* e = entity(cwd, path, FSOperation::write);
-    if (e)
-        static_cast<CodeEntity*>(e)->_code = std::move(content);
-    return e;
+    return entity(cwd, path, FSOperation::write, Intern(std::move(content)));
 }
 
-const std::string& FileSystem::read(const std::string& cwd, const std::string& path)
+const std::string& FileSystem::read(boost::string_view cwd, boost::string_view path) const
 {
     return entity_checked(cwd, path)->code();
 }
 
-bool FileSystem::erase(const std::string& cwd, const std::string& path)
+FileSystem::File FileSystem::open(boost::string_view cwd, boost::string_view path) const
+{
+    File file;
+    auto e = entity(cwd, path, &file.path);
+    if(!e)
+        throw std::runtime_error("file '" + path.to_string() + "' not found");
+    if(e->type() != FSType::CodeFile)
+        throw std::runtime_error("entity is not a code entity");
+    file.code = static_cast<const CodeEntity*>(e)->blob();
+    return file;
+}
+
+bool FileSystem::erase(boost::string_view cwd, boost::string_view path)
 {
     try {
-        entity(cwd, path, FSOperation::erase);
-        return true;
+        return entity(cwd, path, FSOperation::erase) != nullptr;
     }catch(const std::exception&)
     {
         return false;
     }
 }
 
-FileSystem::Entity* FileSystem::entity_checked(const std::string& cwd, const std::string& file, FSOperation op)
+FileSystem::Blob FileSystem::Intern(std::string content)
 {
-    Entity* e = entity(cwd, file, op);
-    if(!e)
-    {
-        throw std::runtime_error("file '" + file + "' not found");
-    }
-    return e;
+    return BlobTable::Instance().intern(std::move(content));
 }
 
-FileSystem::Entity* FileSystem::entity(const std::string& cwd, const std::string& file, FSOperation op)
+std::size_t FileSystem::InternedBlobs()
 {
-    std::string full_path;
-    if(file.size() > 0 && file.front() == '/')
-    {
-        full_path = file;
-    } else {
-        full_path = cwd + "/" + file;
-    }
-
-    // split path (dir1/dir2/file.ext -> [dir1, dir2, file.txt])
-    std::vector<std::string> candidates{};
-    boost::split(candidates, full_path, boost::is_any_of("/"), boost::token_compress_on);
+    return BlobTable::Instance().size();
+}
 
-    // remove empty parts
-    std::vector<std::string> comps{};
-    for(auto it = candidates.begin(); it != candidates.end(); ++it)
+const FileSystem::Entity* FileSystem::entity_checked(boost::string_view cwd, boost::string_view file) const
+{
+    const Entity* e = entity(cwd, file);
+    if(!e)
     {
-        auto& comp = *it;
-        if(*it == "..")
-        {
-            if(comps.size())
-                comps.pop_back();
-        } else if(!it->empty())
-        {
-            comps.push_back(std::move(comp));
-        }
+        throw std::runtime_error("file '" + file.to_string() + "' not found");
     }
+    return e;
+}
 
-    Entity* cur = &_root;
+const FileSystem::Entity* FileSystem::entity(boost::string_view cwd, boost::string_view file, std::string* canonical) const
+{
+    auto comps = resolve_path(cwd, file);
+    const Entity* cur = _root.get();
 
-    int i = 0;
+    std::size_t i = 0;
     for(const auto& comp : comps)
     {
         const bool isLast = (i == comps.size() - 1);
@@ -246,35 +416,57 @@ FileSystem::Entity* FileSystem::entity(const std::string& cwd, const std::string
             return nullptr;
         }
 
-        DirEntity* dir = cur->as_dir();
-
-        switch(op)
-        {
-        case FSOperation::erase:
-            if(isLast)
-            {
-                dir->erase(comp);
-                break;
-            }
-        default:
-            cur = dir->entity(comp, !isLast, false);
-            break;
-        case FSOperation::write:
-            if(isLast)
-                cur = dir->new_file(comp);
-            else
-                cur = dir->entity(comp, true, true);
-            break;
-        };
-
-        if(!cur)
+        auto entry = static_cast<const DirEntity*>(cur)->entry(comp, !isLast);
+        if(!entry)
         {
             // comp does not exist
             return nullptr;
         }
+        cur = entry->second.get();
+        if(canonical)
+            canonical->append("/").append(entry->first);
         ++i;
     }
 
     return cur;
 }
 
+FileSystem::Entity* FileSystem::entity(boost::string_view cwd, boost::string_view file, FSOperation op, Blob code)
+{
+    auto comps = resolve_path(cwd, file);
+    if(comps.empty())
+    {
+        // the root can neither be written nor erased
+        return nullptr;
+    }
+
+    DirEntity* dir = mutable_root();
+    for(std::size_t i = 0; i < comps.size() - 1; ++i)
+    {
+        dir = dir->mutable_dir(comps[i], op == FSOperation::write);
+        if(!dir)
+        {
+            // comp does not exist or is not a directory
+            return nullptr;
+        }
+    }
+
+    switch(op)
+    {
+    case FSOperation::write:
+        return dir->new_file(comps.back(), std::move(code));
+    case FSOperation::erase:
+        dir->erase(comps.back());
+        return dir;
+    }
+    return nullptr;
+}
+
+FileSystem::DirEntity* FileSystem::mutable_root()
+{
+    if(_root.use_count() > 1)
+        _root = std::make_shared<DirEntity>(*_root);
+    else
+        owned_exclusively();
+    return _root.get();
+}
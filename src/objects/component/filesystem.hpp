@@ -1,10 +1,15 @@
 #pragma once
 
 
-#include <unordered_map>
 #include <vector>
 #include <string>
 #include <memory>
+#include <array>
+#include <set>
+#include <stdexcept>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/utility/string_view.hpp>
 
 enum class FSType
 {
@@ -13,9 +18,17 @@ enum class FSType
     Directory
 };
 
+// A ship's files.
+// File contents are immutable blobs, interned by their content, so the same
+// code uploaded to many ships is stored once. Directory trees are copy on
+// write: copying a FileSystem copies a pointer, and a write copies only the
+// directories on its path that are still shared.
+// Copies can be used from different threads, a single FileSystem can not.
 class FileSystem
 {
 public:
+    using Blob = std::shared_ptr<const std::string>;
+
     struct DirEntity;
     struct Entity
     {
@@ -23,54 +36,108 @@ public:
         virtual FSType type() const = 0;
 
         virtual const std::string& code() const { throw std::runtime_error("entity is not a code entity"); }
-        virtual DirEntity* as_dir() { throw std::runtime_error("entity is not a directory"); }
     };
 
     class CodeEntity: public Entity
     {
     public:
+        explicit CodeEntity(Blob code);
+
         virtual FSType type() const override;
         virtual const std::string& code() const override;
 
-        std::string _code;
+        const Blob& blob() const;
+
+    private:
+        const Blob _code;
+    };
+
+    // names are looked up by string_view without creating a std::string
+    struct NameHash
+    {
+        std::size_t operator()(boost::string_view name) const
+        {
+            return boost::hash_range(name.begin(), name.end());
+        }
+    };
+
+    struct NameEqual
+    {
+        bool operator()(boost::string_view a, boost::string_view b) const
+        {
+            return a == b;
+        }
     };
 
     class DirEntity: public Entity
     {
     public:
-        using entity_map = std::unordered_map<std::string, std::unique_ptr<Entity>>;
+        using entity_map = boost::unordered_map<std::string, std::shared_ptr<Entity>, NameHash, NameEqual>;
         virtual FSType type() const override;
-        virtual DirEntity* as_dir() override;
-        Entity* entity(const std::string& file, bool wantdir, bool createdir);
-        Entity* new_file(std::string file);
-        void erase(const std::string& file);
+        // name and entity, nullptr if there is none
+        const entity_map::value_type* entry(boost::string_view file, bool wantdir) const;
+        // the directory, copied first if it is shared with another tree
+        DirEntity* mutable_dir(boost::string_view file, bool createdir);
+        Entity* new_file(boost::string_view file, Blob code);
+        void erase(boost::string_view file);
     private:
-        entity_map::iterator entity(const std::string& file, bool wantdir);
-        entity_map::iterator semvered_entity(const std::string& file, std::string::size_type verpos, bool wantdir);
+        using semver = std::array<unsigned int, 3>;
+        // ordered by version, then by name for entries with equal versions
+        using version_set = std::set<std::pair<semver, std::string>>;
+
+        template<typename Self>
+        static auto find(Self& self, boost::string_view file, bool wantdir) -> decltype(self._content.begin());
+        template<typename Self>
+        static auto semvered_entity(Self& self, boost::string_view file, bool wantdir) -> decltype(self._content.begin());
+        entity_map::iterator emplace(const std::string& file, std::shared_ptr<Entity> entity);
+        void remove(entity_map::iterator it);
     private:
-        std::unordered_map<std::string, std::unique_ptr<Entity>> _content;
+        entity_map _content;
+        // Versions of all entries, by the lookup they answer.
+        // "boot-1.2.js" is found by "boot-^.js", "boot-1.^.js" and
+        // "boot-1^.js" among others, so it is listed under each of them.
+        boost::unordered_map<std::string, version_set, NameHash, NameEqual> _versions;
     };
 public:
+    // starts empty, all empty file systems share one root
     FileSystem();
+    // copies share the tree
+    FileSystem(const FileSystem&) = default;
+    FileSystem& operator=(const FileSystem&) = default;
     ~FileSystem();
 
-    bool exists(const std::string& cwd, const std::string& path);
-    FSType type(const std::string& cwd, const std::string& path);
+    bool exists(boost::string_view cwd, boost::string_view path) const;
+    FSType type(boost::string_view cwd, boost::string_view path) const;
+
+    Entity* write(boost::string_view cwd, boost::string_view path, std::string content);
+    const std::string& read(boost::string_view cwd, boost::string_view path) const;
 
-    Entity* write(const std::string& cwd, const std::string& path, std::string content);
-    const std::string& read(const std::string& cwd, const std::string& path);
-    bool erase(const std::string& cwd, const std::string& path);
+    struct File
+    {
+        std::string path;   // absolute, with the names versions resolved to
+        Blob code;
+    };
+    // like read, but tells which file was read
+    File open(boost::string_view cwd, boost::string_view path) const;
+    bool erase(boost::string_view cwd, boost::string_view path);
+
+    // the blob with this content, shared with every file that has the same content
+    static Blob Intern(std::string content);
+    // distinct contents of all file systems
+    static std::size_t InternedBlobs();
 
 private:
     enum class FSOperation
     {
-        none,
         write,
         erase
     };
-    Entity* entity_checked(const std::string& cwd, const std::string& file, FSOperation op = FSOperation::none);
-    Entity* entity(const std::string& cwd, const std::string& file, FSOperation op = FSOperation::none);
+    const Entity* entity_checked(boost::string_view cwd, boost::string_view file) const;
+    // appends the path of the entity to canonical, if given
+    const Entity* entity(boost::string_view cwd, boost::string_view file, std::string* canonical = nullptr) const;
+    Entity* entity(boost::string_view cwd, boost::string_view file, FSOperation op, Blob code = nullptr);
+    DirEntity* mutable_root();
 
 private:
-    DirEntity _root;
-};
\ No newline at end of file
+    std::shared_ptr<DirEntity> _root;
+};
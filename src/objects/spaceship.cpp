@@ -3,11 +3,17 @@
 #include "game.hpp"
 #include "scripting/processor.hpp"
 #include "scripting/binding.hpp"
+#include "scripting/module_loader.hpp"
+#include "scripting/snapshot.hpp"
+#include "scripting/promise_board.hpp"
 
 #include "component/filesystem.hpp"
 
+#include "log.hpp"
+
+#include <algorithm>
 #include <chrono>
-#include <iostream>
+#include <cmath>
 
 using v8::Isolate;
 using v8::Local;
@@ -20,74 +26,268 @@ using namespace std::placeholders;
 class ShipAi
 {
 public:
+    static constexpr float MineRange = 10.f;        // in meter
+    static constexpr unsigned int MinePower = 10;   // resource units per mine()
+    static constexpr const char* BootPath = "/boot/boot-^";
+
     ShipAi(Spaceship* ship)
         : _ship(*ship)
+        , _files(ship->_fs)
     {
         Game& game = Game::Current();
-        _proc = game.processor_pool()->newProcessor(std::chrono::milliseconds(10), std::bind(&ShipAi::init_ctx, this, _1));
+        auto& budget = game.script_budget(_ship.player().resolve());
+        _proc = game.processor_pool()->newProcessor(budget, Snapshot(), std::bind(&ShipAi::init_ctx, this, _1));
         _proc->post(std::bind(&ShipAi::bootup, this, _1, _2));
+        _roundSub = game.on_script_round().subscribe([this]() {
+            if(_rebootRequested)
+            {
+                // destroys this, the subscription outlives the call
+                _ship.interact_reboot();
+                return;
+            }
+            _promises.settle(*_proc);
+        });
     }
 
     ~ShipAi()
     {
     }
 
+    // Swaps the ship's code for files in the running script, see
+    // ModuleLoader::reload. If that fails the ship reboots before the next
+    // round. False if the script is not running anymore.
+    bool reload(const FileSystem& files)
+    {
+        if(_rebootRequested || _proc->stats().out_of_memory)
+            return false;
+
+        _proc->post([this, files](Isolate* iso, LCtx& ctx)
+        {
+            v8::TryCatch tryCatch(iso);
+            if(ModuleLoader::FromContext(ctx)->reload(ctx, files))
+                return;
+
+            if(tryCatch.HasCaught())
+                log_failure(iso, ctx, tryCatch, "failed to hot reload");
+            SC_LOG(Info, Scripting) << "can not hot reload, rebooting";
+            _rebootRequested = true;
+        });
+        return true;
+    }
+
 private:
+    // the ship api, built once and deserialized for every ship
+    static const std::shared_ptr<ContextSnapshot>& Snapshot()
+    {
+        // never destroyed, like ContextSnapshot::Default()
+        static auto snapshot = new std::shared_ptr<ContextSnapshot>(ContextSnapshot::Create(ContextBlueprint{
+            {
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::position)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::set_target)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::in_sight)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::positions_in_sight)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::arrive)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::sleep)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::scan)::SlotCallback()),
+                reinterpret_cast<intptr_t>(FWrap(&ShipAi::mine)::SlotCallback())
+            },
+            [](Isolate* iso, LCtx ctx)
+            {
+                using namespace bd;
+                auto global = ctx->Global();
+                global->Set(ctx, str("position"), FWrap(&ShipAi::position)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("flyTo"), FWrap(&ShipAi::set_target)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("inSight"), FWrap(&ShipAi::in_sight)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("positionsInSight"), FWrap(&ShipAi::positions_in_sight)::NewSlotFunction(ctx)).FromJust();
+                // promises, settled by the game loop
+                global->Set(ctx, str("arrive"), FWrap(&ShipAi::arrive)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("sleep"), FWrap(&ShipAi::sleep)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("scan"), FWrap(&ShipAi::scan)::NewSlotFunction(ctx)).FromJust();
+                global->Set(ctx, str("mine"), FWrap(&ShipAi::mine)::NewSlotFunction(ctx)).FromJust();
+            }
+        }));
+        return *snapshot;
+    }
+
     LCtx init_ctx(Isolate* iso)
     {
-        using namespace v8;
-        using namespace bd;
+        auto ctx = Context::New(iso);
+        ctx->SetAlignedPointerInEmbedderData(bd::ThisSlot, this);
+        PromiseBoard::Install(ctx);
+        return ctx;
+    }
 
-        auto global = ObjectTemplate::New(iso);
-        global->Set(str("position"), FWrap(&Spaceship::position)::NewTemplate(iso, &_ship));
-        global->Set(str("flyTo"), FWrap(&ShipAi::set_target)::NewTemplate(iso, this));
-        return Context::New(iso, nullptr, global);
+    vec2 position() const
+    {
+        return _ship.position();
     }
 
     void set_target(vec2 target)
     {
         _ship.set_target(target);
     }
-    
-    void bootup(Isolate* iso, LCtx ctx)
+
+    // ids of all objects the ship's fraction sees
+    std::vector<id_value_type> in_sight() const
     {
-        try {
-            auto code = _ship._fs->read("", "/boot/boot-^");
-            Local<v8::String> source = bd::str(code);
-            v8::MaybeLocal<v8::Script> script = v8::Script::Compile(ctx, source);
-            if (script.IsEmpty()) {
-                std::cerr << "Failed to compile script!" << std::endl;
-                return;
+        std::vector<id_value_type> ids;
+        for(auto obj : _ship.fraction()->visible_objects())
+        {
+            if(obj != &_ship)
+                ids.push_back(obj->id().value());
+        }
+        return ids;
+    }
+
+    // positions of the objects in_sight() returns, in the same order
+    bd::Vec2Array positions_in_sight() const
+    {
+        bd::Vec2Array positions;
+        for(auto obj : _ship.fraction()->visible_objects())
+        {
+            if(obj != &_ship)
+                positions.values.push_back(obj->position());
+        }
+        return positions;
+    }
+
+    // resolves with the position once the ship stands still on its target
+    Local<Value> arrive()
+    {
+        return _promises.add(current_ctx(), [this]() -> boost::optional<PromiseBoard::Outcome>
+        {
+            if(_ship.has_target() && !_ship.arrived())
+                return boost::none;
+            return PromiseBoard::Resolve(_ship.position());
+        });
+    }
+
+    // resolves after the given number of ticks, at least the next one
+    Local<Value> sleep(uint32_t ticks)
+    {
+        return _promises.add(current_ctx(), [ticks]() mutable -> boost::optional<PromiseBoard::Outcome>
+        {
+            if(ticks > 1)
+            {
+                --ticks;
+                return boost::none;
             }
-            auto result = script.ToLocalChecked()->Run(ctx);
-        } catch (std::runtime_error& e)
+            return PromiseBoard::Outcome{};
+        });
+    }
+
+    // resolves with {resource, amount} in the next tick
+    Local<Value> scan(id_value_type id)
+    {
+        return _promises.add(current_ctx(), [this, id]() -> boost::optional<PromiseBoard::Outcome>
         {
-            std::cerr << "failed to find boot script!" << std::endl;
-        } catch (std::exception& e)
+            auto obj = find_in_sight(id);
+            if(!obj)
+                return PromiseBoard::Reject("object is not in sight");
+
+            auto result = obj->interact_scan();
+            std::string resource = result.resource ? (*result.resource)->name() : std::string();
+            unsigned int amount = result.resource_amount.value_or(0);
+            return PromiseBoard::Outcome{false, [resource, amount](Isolate* iso, LCtx ctx) -> Local<Value>
+            {
+                auto obj = v8::Object::New(iso);
+                if(!resource.empty())
+                    obj->Set(ctx, bd::str("resource"), bd::toLocal(iso, ctx, resource)).FromJust();
+                obj->Set(ctx, bd::str("amount"), bd::toLocal(iso, ctx, uint32_t(amount))).FromJust();
+                return obj;
+            }};
+        });
+    }
+
+    // resolves with the mined amount in the next tick, the object must be within MineRange
+    Local<Value> mine(id_value_type id)
+    {
+        return _promises.add(current_ctx(), [this, id]() -> boost::optional<PromiseBoard::Outcome>
         {
-            std::cerr << "failed to execute script: " << e.what() << std::endl;
-        } catch (...)
+            auto obj = find_in_sight(id);
+            if(!obj)
+                return PromiseBoard::Reject("object is not in sight");
+
+            auto d = obj->position() - _ship.position();
+            if(std::sqrt(d.x * d.x + d.y * d.y) > MineRange)
+                return PromiseBoard::Reject("object is out of range");
+
+            auto result = obj->interact_mine(MinePower);
+            if(!result)
+                return PromiseBoard::Reject("object can not be mined");
+            return PromiseBoard::Resolve(uint32_t(result->amount));
+        });
+    }
+
+    GameObject* find_in_sight(id_value_type id) const
+    {
+        auto& visible = _ship.fraction()->visible_objects();
+        auto it = std::find_if(visible.begin(), visible.end(), [id](GameObject* obj)
         {
-            std::cerr << "unknown error while executing script!" << std::endl;
+            return obj->id().value() == id;
+        });
+        return it != visible.end() ? *it : nullptr;
+    }
+
+    static LCtx current_ctx()
+    {
+        return Isolate::GetCurrent()->GetCurrentContext();
+    }
+    
+    void bootup(Isolate* iso, LCtx ctx)
+    {
+        auto loader = std::make_shared<ModuleLoader>(iso, _files);
+        loader->install(ctx);
+        Processor::FromContext(ctx)->attach(loader);
+
+        v8::TryCatch tryCatch(iso);
+        if(loader->run(ctx, BootPath).IsEmpty())
+            log_failure(iso, ctx, tryCatch, "failed to boot");
+    }
+
+    static void log_failure(Isolate* iso, LCtx ctx, const v8::TryCatch& tryCatch, const char* what)
+    {
+        if(tryCatch.HasTerminated())
+            return;
+
+        try {
+            SC_LOG(Warning, Scripting) << what << ": " << bd::fromLocal<std::string>(iso, ctx, tryCatch.Exception());
+        } catch(std::exception& e)
+        {
+            SC_LOG(Warning, Scripting) << what << "!";
         }
     }
 
 
 private:
     Spaceship& _ship;
+    const FileSystem _files;        // as they were at boot, the game may write to the ship's meanwhile
     std::shared_ptr<Processor> _proc;
+    PromiseBoard _promises;         // only touched between rounds or by the ship's own script
+    subscription _roundSub;
+    bool _rebootRequested = false;  // by a failed reload during a round, read between rounds
 };
 
 
 
-Spaceship::Spaceship(player_id player)
+Spaceship::Spaceship(player_id player, FileSystem files)
     : GameObject("Spaceship(" + Game::Current().resolve_player(player).name() + ")")
     , _player(player)
+    , _fs(std::move(files))
 {
-    _fs = std::make_shared<FileSystem>();
     activate();
 }
 
+player_id Spaceship::player() const
+{
+    return _player;
+}
+
+Fraction* Spaceship::fraction() const
+{
+    return &_player.resolve().fraction();
+}
+
 float Spaceship::sight() const        // in meter
 {
     return 100.f;
@@ -111,7 +311,7 @@ ScanResult Spaceship::interact_scan()
 
 bool Spaceship::interact_send_code(const std::string& path, const std::string& code)
 {
-    return _fs->write("", path, code) != nullptr;
+    return _fs.write("", path, code) != nullptr;
 }
 
 bool Spaceship::interact_reboot()
@@ -120,6 +320,11 @@ bool Spaceship::interact_reboot()
     return true;
 }
 
+bool Spaceship::interact_reload()
+{
+    return _ai && _ai->reload(_fs);
+}
+
 /*
     virtual void boot_script(std::string code) override
     {
@@ -2,20 +2,22 @@
 
 #include "game_object.hpp"
 #include "player.hpp"
+#include "component/filesystem.hpp"
 
 
 class ShipAi;
-class FileSystem;
 
 
 class Spaceship : public GameObject
 {
     friend class ShipAi;
 public:
-    Spaceship(player_id player);
+    // files are shared with where they came from until the ship writes to them
+    Spaceship(player_id player, FileSystem files = FileSystem());
 
     player_id player() const;
 
+    virtual Fraction* fraction() const override;
 
     virtual float sight() const override;        // in meter
     virtual float acceleration() const override; // in meter per second^2
@@ -24,11 +26,12 @@ public:
     virtual ScanResult interact_scan() override;
     virtual bool interact_send_code(const std::string& path, const std::string& code) override;
     virtual bool interact_reboot() override;
+    virtual bool interact_reload() override;
 
 public:
     static std::shared_ptr<Spaceship> Create(player_id player);
 protected:
     player_id _player;
     std::shared_ptr<ShipAi> _ai;
-    std::shared_ptr<FileSystem> _fs;
+    FileSystem _fs;
 };
\ No newline at end of file
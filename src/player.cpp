@@ -18,10 +18,11 @@ Player& player_id::resolve() const
 
 
 
-Player::Player(const player_id& id, const std::string& name, Fraction& fraction)
+Player::Player(const player_id& id, const std::string& name, Fraction& fraction, unsigned int tier)
     : _id(id)
     , _name(name)
     , _fraction(fraction)
+    , _tier(tier)
 {
 }
 
@@ -40,3 +41,8 @@ Fraction& Player::fraction()
 {
     return _fraction;
 }
+
+unsigned int Player::tier() const
+{
+    return _tier;
+}
@@ -26,15 +26,17 @@ MAKE_ID_HASH(player_id);
 class Player: boost::noncopyable
 {
 public:
-    Player(const player_id& id, const std::string& name, Fraction& fraction);
+    Player(const player_id& id, const std::string& name, Fraction& fraction, unsigned int tier = 0);
 
     const player_id& id() const;
     const std::string& name() const;
     Fraction& fraction();
+    unsigned int tier() const;  // selects the script budget
 
     std::shared_ptr<Spaceship> mainShip;
 private:
     const player_id _id;
     const std::string _name;
     Fraction& _fraction;
+    const unsigned int _tier;
 };
\ No newline at end of file
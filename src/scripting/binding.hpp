@@ -8,15 +8,22 @@
 #include <type_traits>
 #include <utility>
 #include <array>
-#include <iostream>
+#include <vector>
 #include <functional>
 
 #include "defs.hpp"
 #include "processor.hpp"
+#include "isolate_cache.hpp"
+#include "log.hpp"
 
 namespace bd {
     using namespace v8;
 
+    // context embedder data slots, 1 is the processor
+    const int ThisSlot = 2;         // object used by slot bound functions
+    const int PromiseSlot = 3;      // pending promises of a PromiseBoard
+    const int ModuleSlot = 4;       // ModuleLoader resolving the context's imports
+
     template<typename T>
     Local<Value> toLocal(Isolate* iso, Local<Context> ctx, const T& val);
 
@@ -44,6 +51,13 @@ namespace bd {
     }
 
 
+    // Vectors handed over in bulk, as one Float32Array of x, y pairs
+    // filled in place instead of an array of objects.
+    struct Vec2Array
+    {
+        std::vector<vec2> values;
+    };
+
     namespace detail
     {
         template<typename T>
@@ -111,19 +125,19 @@ namespace bd {
 
                 return [func, proc](Args... args) -> void
                 {
-                    std::cout << "before post" << std::endl;
+                    SC_LOG(Trace, Scripting) << "posting callback";
                     proc->post([func, args...](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
                     {
-                        std::cout << "begin execute call" << std::endl;
+                        SC_LOG(Trace, Scripting) << "begin execute call";
                         std::array<Local<Value>, sizeof...(Args)> argList = {
                             ::bd::toLocal(iso, ctx, args)...
                         };
                         auto func_l = func.Get(iso);
                         
                         func_l->Call(ctx->Global(), argList.size(), argList.data());
-                        std::cout << "end execute call" << std::endl;
+                        SC_LOG(Trace, Scripting) << "end execute call";
                     });
-                    std::cout << "before post" << std::endl;
+                    SC_LOG(Trace, Scripting) << "posted callback";
                 };
             }
 
@@ -134,26 +148,93 @@ namespace bd {
             }
         };
 
+        template<typename T>
+        struct converter<std::vector<T>>
+        {
+            static inline std::vector<T> from_local(Isolate* iso, Local<Context> ctx, Local<Value> local)
+            {
+                if(!local->IsArray())
+                    throw std::runtime_error("Expected array");
+                auto arr = local.As<Array>();
+                std::vector<T> result;
+                result.reserve(arr->Length());
+                for(uint32_t i = 0; i < arr->Length(); ++i)
+                {
+                    result.push_back(converter<T>::from_local(iso, ctx, unwrap(arr->Get(ctx, i), "Failed to read array")));
+                }
+                return result;
+            }
+
+            static inline Local<Array> to_local(Isolate* iso, Local<Context> ctx, const std::vector<T>& vec)
+            {
+                auto arr = Array::New(iso, int(vec.size()));
+                for(uint32_t i = 0; i < vec.size(); ++i)
+                {
+                    arr->Set(ctx, i, converter<T>::to_local(iso, ctx, vec[i])).FromJust();
+                }
+                return arr;
+            }
+        };
+
         template<>
         struct converter<vec2>
         {
             static inline vec2 from_local(Isolate* iso, Local<Context> ctx, Local<Value> local)
             {
+                auto& cache = IsolateCache::Get(iso);
                 auto obj = unwrap(local->ToObject(ctx), "vector must be an object!");
-                auto x = unwrap(obj->Get(ctx, str("x")), "vector needs a x property");
-                auto y = unwrap(obj->Get(ctx, str("y")), "vector needs a y property");
+                auto x = unwrap(obj->Get(ctx, cache.x()), "vector needs a x property");
+                auto y = unwrap(obj->Get(ctx, cache.y()), "vector needs a y property");
                 return vec2(unwrap(x->ToNumber(ctx), "x must be a number")->Value(),
                             unwrap(y->ToNumber(ctx), "y must be a number")->Value());
             }
 
             static inline Local<v8::Object> to_local(Isolate* iso, Local<Context> ctx, const vec2& vec)
             {
+                // always x, then y with the same keys, so all vectors share one hidden class
+                auto& cache = IsolateCache::Get(iso);
                 auto obj = v8::Object::New(iso);
-                obj->Set(str("x"), Number::New(iso, vec.x));
-                obj->Set(str("y"), Number::New(iso, vec.y));
+                obj->Set(ctx, cache.x(), Number::New(iso, vec.x)).FromJust();
+                obj->Set(ctx, cache.y(), Number::New(iso, vec.y)).FromJust();
                 return obj;
             }
         };
+
+        template<>
+        struct converter<Vec2Array>
+        {
+            static inline Vec2Array from_local(Isolate* iso, Local<Context> ctx, Local<Value> local)
+            {
+                if(!local->IsFloat32Array())
+                    throw std::runtime_error("Expected Float32Array");
+                auto arr = local.As<Float32Array>();
+                if(arr->Length() % 2)
+                    throw std::runtime_error("Expected x, y pairs");
+
+                std::vector<float> floats(arr->Length());
+                arr->CopyContents(floats.data(), floats.size() * sizeof(float));
+                Vec2Array result;
+                result.values.reserve(floats.size() / 2);
+                for(std::size_t i = 0; i < floats.size(); i += 2)
+                {
+                    result.values.emplace_back(floats[i], floats[i + 1]);
+                }
+                return result;
+            }
+
+            static inline Local<Float32Array> to_local(Isolate* iso, Local<Context> ctx, const Vec2Array& arr)
+            {
+                auto length = arr.values.size() * 2;
+                auto buffer = ArrayBuffer::New(iso, length * sizeof(float));
+                auto data = static_cast<float*>(buffer->GetContents().Data());
+                for(auto& vec : arr.values)
+                {
+                    *data++ = float(vec.x);
+                    *data++ = float(vec.y);
+                }
+                return Float32Array::New(buffer, 0, length);
+            }
+        };
     }
 
     template<typename T>
@@ -178,48 +259,58 @@ namespace bd {
 
             constexpr static std::size_t arg_num = sizeof...(Args);
 
-            template<void (This::*Func)(Args...), typename Dump = void>
+            static This* this_from_data(const FunctionCallbackInfo<Value>& info)
+            {
+                return reinterpret_cast<This*>(info.Data().As<External>()->Value());
+            }
+
+            static This* this_from_slot(const FunctionCallbackInfo<Value>& info)
+            {
+                return reinterpret_cast<This*>(info.GetIsolate()->GetCurrentContext()->GetAlignedPointerFromEmbedderData(ThisSlot));
+            }
+
+            using resolve_func = This* (*)(const FunctionCallbackInfo<Value>&);
+
+            template<void (This::*Func)(Args...), resolve_func Resolve = &this_from_data, typename Dump = void>
             static auto callback_entry(const FunctionCallbackInfo<Value>& info) -> typename std::enable_if<std::is_void<Ret>::value, Dump>::type
             {
-                void_callback_entry(Func, info, std::make_index_sequence<arg_num>());
+                void_callback_entry(Func, Resolve(info), info, std::make_index_sequence<arg_num>());
             }
 
-            template<void (This::*Func)(Args...) const, typename Dump = void>
+            template<void (This::*Func)(Args...) const, resolve_func Resolve = &this_from_data, typename Dump = void>
             static auto callback_entry(const FunctionCallbackInfo<Value>& info) -> typename std::enable_if<std::is_void<Ret>::value, Dump>::type
             {
-                void_callback_entry(Func, info, std::make_index_sequence<arg_num>());
+                void_callback_entry(Func, Resolve(info), info, std::make_index_sequence<arg_num>());
             }
 
-            template<Ret (This::*Func)(Args...), typename Dump = void>
+            template<Ret (This::*Func)(Args...), resolve_func Resolve = &this_from_data, typename Dump = void>
             static auto callback_entry(const FunctionCallbackInfo<Value>& info) -> typename std::enable_if<!std::is_void<Ret>::value, Dump>::type
             {
-                ret_callback_entry(Func, info, std::make_index_sequence<arg_num>());
+                ret_callback_entry(Func, Resolve(info), info, std::make_index_sequence<arg_num>());
             }
 
-            template<Ret (This::*Func)(Args...) const, typename Dump = void>
+            template<Ret (This::*Func)(Args...) const, resolve_func Resolve = &this_from_data, typename Dump = void>
             static auto callback_entry(const FunctionCallbackInfo<Value>& info) -> typename std::enable_if<!std::is_void<Ret>::value, Dump>::type
             {
-                ret_callback_entry(Func, info, std::make_index_sequence<arg_num>());
+                ret_callback_entry(Func, Resolve(info), info, std::make_index_sequence<arg_num>());
             }
 
         private:
             template<typename Func, std::size_t... I>
-            static void void_callback_entry(Func func, const FunctionCallbackInfo<Value>& info, std::index_sequence<I...>)
+            static void void_callback_entry(Func func, This* ths, const FunctionCallbackInfo<Value>& info, std::index_sequence<I...>)
             {
                 auto iso = info.GetIsolate();
                 HandleScope hScope(iso);
                 auto ctx = iso->GetCurrentContext();
-                This* ths = reinterpret_cast<This*>(info.Data().As<External>()->Value());
                 (ths->*func)(fromLocal<Args>(iso, ctx, info[I])...);
             }
 
             template<typename Func, std::size_t... I>
-            static void ret_callback_entry(Func func, const FunctionCallbackInfo<Value>& info, std::index_sequence<I...>)
+            static void ret_callback_entry(Func func, This* ths, const FunctionCallbackInfo<Value>& info, std::index_sequence<I...>)
             {
                 auto iso = info.GetIsolate();
                 HandleScope hScope(iso);
                 auto ctx = iso->GetCurrentContext();
-                This* ths = reinterpret_cast<This*>(info.Data().As<External>()->Value());
                 info.GetReturnValue().Set(toLocal<Ret>(iso, ctx, (ths->*func)(fromLocal<Args>(iso, ctx, info[I])...)));
             }
         };
@@ -244,9 +335,23 @@ namespace bd {
             template<typename T>
             static Local<Function> NewFunction(Local<Context> ctx, T* ths)
             {
-                return unwrap(Function::New(ctx, &signature::template callback_entry<Func>, External::New(ctx->GetIsolate(), ths), Local<Signature>(), signature::arg_num),
+                return unwrap(Function::New(ctx, &signature::template callback_entry<Func>, External::New(ctx->GetIsolate(), ths), signature::arg_num),
                         "Failed to create new function");
             }
+
+            // A function that takes its object from the ThisSlot of the calling
+            // context. It holds no pointer, so it can be put into a ContextSnapshot.
+            static Local<Function> NewSlotFunction(Local<Context> ctx)
+            {
+                return unwrap(Function::New(ctx, SlotCallback(), Local<Value>(), signature::arg_num),
+                        "Failed to create new function");
+            }
+
+            // to be listed in the external references of a ContextSnapshot
+            static FunctionCallback SlotCallback()
+            {
+                return &signature::template callback_entry<Func, &signature::this_from_slot>;
+            }
         };
     }
 
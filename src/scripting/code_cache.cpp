@@ -0,0 +1,390 @@
+#include "code_cache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "log.hpp"
+
+// V8 consumes code caches for modules since 7.1
+#if V8_MAJOR_VERSION > 7 || (V8_MAJOR_VERSION == 7 && V8_MINOR_VERSION >= 1)
+#define SC_MODULE_CODE_CACHE 1
+#else
+#define SC_MODULE_CODE_CACHE 0
+#endif
+
+namespace {
+    const char FileMagic[4] = {'S', 'C', 'C', '1'};
+
+    std::uint64_t fnv1a(const std::string& data)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for(unsigned char c : data)
+        {
+            hash ^= c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // the lowest bit tells modules from scripts with the same source
+    std::uint64_t key_of(const std::string& code, bool module)
+    {
+        return (fnv1a(code) << 1) | (module? 1 : 0);
+    }
+
+    const char FileExtension[] = ".v8cache";
+    const std::uintmax_t FileHeaderSize = sizeof(FileMagic) + sizeof(std::uint64_t);
+}
+
+CodeCache& CodeCache::Global()
+{
+    static CodeCache cache;
+    return cache;
+}
+
+void CodeCache::set_directory(const std::string& dir)
+{
+    namespace fs = boost::filesystem;
+
+    // files of earlier runs, most recently used first
+    std::vector<std::pair<std::time_t, CacheFile>> found;
+    if(!dir.empty())
+    {
+        fs::create_directories(dir);
+        for(auto& f : fs::directory_iterator(dir))
+        {
+            boost::system::error_code ec;
+            if(f.path().extension() != FileExtension || !fs::is_regular_file(f.status()))
+                continue;
+            auto size = fs::file_size(f.path(), ec);
+            auto time = fs::last_write_time(f.path(), ec);
+            if(!ec)
+                found.emplace_back(time, CacheFile{f.path().filename().string(), size});
+        }
+        std::sort(found.begin(), found.end(), [](const std::pair<std::time_t, CacheFile>& a, const std::pair<std::time_t, CacheFile>& b)
+        {
+            return a.first > b.first;
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _directory = dir;
+    _files.clear();
+    _fileIndex.clear();
+    _fileBytes = 0;
+    for(auto& f : found)
+    {
+        _files.push_back(std::move(f.second));
+        _fileIndex.emplace(_files.back().name, std::prev(_files.end()));
+        _fileBytes += _files.back().size;
+    }
+    evict();
+}
+
+void CodeCache::set_capacity(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capacity = bytes;
+    evict();
+}
+
+v8::MaybeLocal<v8::Script> CodeCache::compile(v8::Isolate* iso, v8::Local<v8::Context> ctx, const Blob& code)
+{
+    using v8::ScriptCompiler;
+
+    v8::Local<v8::String> str;
+    if(!v8::String::NewFromUtf8(iso, code->c_str(), v8::NewStringType::kNormal, int(code->size())).ToLocal(&str))
+        return {};
+
+    auto key = key_of(*code, false);
+    v8::MaybeLocal<v8::Script> script;
+    if(auto data = find(key, code))
+    {
+        // the source owns the CachedData object, but not the buffer, which data keeps alive
+        ScriptCompiler::Source source(str, new ScriptCompiler::CachedData(
+            reinterpret_cast<const std::uint8_t*>(data->data()), int(data->size())));
+        script = ScriptCompiler::Compile(ctx, &source, ScriptCompiler::kConsumeCodeCache);
+        if(!source.GetCachedData()->rejected)
+        {
+            ++_hits;
+            return script;
+        }
+
+        ++_rejected;
+        SC_LOG(Debug, Scripting) << "code cache data was rejected, recompiling";
+        erase(key);
+    } else {
+        ++_misses;
+        ScriptCompiler::Source source(str);
+        script = ScriptCompiler::Compile(ctx, &source);
+    }
+
+    v8::Local<v8::Script> compiled;
+    if(script.ToLocal(&compiled))
+    {
+        std::unique_ptr<ScriptCompiler::CachedData> data(ScriptCompiler::CreateCodeCache(compiled->GetUnboundScript()));
+        if(data)
+            store(key, code, data.get());
+    }
+    return script;
+}
+
+v8::MaybeLocal<v8::Module> CodeCache::compile_module(v8::Isolate* iso, const Blob& code, const std::string& name)
+{
+    using v8::ScriptCompiler;
+
+    v8::Local<v8::String> str, resource;
+    if(!v8::String::NewFromUtf8(iso, code->c_str(), v8::NewStringType::kNormal, int(code->size())).ToLocal(&str)
+        || !v8::String::NewFromUtf8(iso, name.c_str(), v8::NewStringType::kNormal, int(name.size())).ToLocal(&resource))
+        return {};
+
+    v8::ScriptOrigin origin(resource, v8::Local<v8::Integer>(), v8::Local<v8::Integer>(), v8::Local<v8::Boolean>(),
+                            v8::Local<v8::Integer>(), v8::Local<v8::Value>(), v8::Local<v8::Boolean>(),
+                            v8::Local<v8::Boolean>(), v8::True(iso));
+
+#if SC_MODULE_CODE_CACHE
+    auto key = key_of(*code, true);
+    v8::MaybeLocal<v8::Module> module;
+    if(auto data = find(key, code))
+    {
+        ScriptCompiler::Source source(str, origin, new ScriptCompiler::CachedData(
+            reinterpret_cast<const std::uint8_t*>(data->data()), int(data->size())));
+        module = ScriptCompiler::CompileModule(iso, &source, ScriptCompiler::kConsumeCodeCache);
+        if(!source.GetCachedData()->rejected)
+        {
+            ++_hits;
+            return module;
+        }
+
+        ++_rejected;
+        SC_LOG(Debug, Scripting) << "module cache data was rejected, recompiling";
+        erase(key);
+    } else {
+        ++_misses;
+        ScriptCompiler::Source source(str, origin);
+        module = ScriptCompiler::CompileModule(iso, &source);
+    }
+
+    // only possible before the module is evaluated
+    v8::Local<v8::Module> compiled;
+    if(module.ToLocal(&compiled))
+    {
+        std::unique_ptr<ScriptCompiler::CachedData> data(ScriptCompiler::CreateCodeCache(compiled->GetUnboundModuleScript()));
+        if(data)
+            store(key, code, data.get());
+    }
+    return module;
+#else
+    ++_misses;
+    ScriptCompiler::Source source(str, origin);
+    return ScriptCompiler::CompileModule(iso, &source);
+#endif
+}
+
+CodeCache::Stats CodeCache::stats() const
+{
+    Stats stats;
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.rejected = _rejected;
+    return stats;
+}
+
+std::size_t CodeCache::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+std::size_t CodeCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+CodeCache::data_ptr CodeCache::find(std::uint64_t key, const Blob& code)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _index.find(key);
+        if(it != _index.end())
+        {
+            // interned sources are equal if they are the same blob, others are compared
+            auto& entry = *it->second;
+            if(entry.code != code && *entry.code != *code)
+                return nullptr;     // another source with the same hash, replaced once compiled
+            _entries.splice(_entries.begin(), _entries, it->second);
+            return entry.data;
+        }
+        if(_directory.empty())
+            return nullptr;
+    }
+
+    auto data = load(key, *code);
+    if(data)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        insert(key, code, data);
+    }
+    return data;
+}
+
+void CodeCache::store(std::uint64_t key, const Blob& code, v8::ScriptCompiler::CachedData* data)
+{
+    auto bytes = std::make_shared<const std::string>(reinterpret_cast<const char*>(data->data), std::size_t(data->length));
+    bool persist;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        insert(key, code, bytes);
+        persist = !_directory.empty();
+    }
+    if(persist)
+        save(key, *code, *bytes);
+}
+
+void CodeCache::erase(std::uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(key);
+    if(it == _index.end())
+        return;
+    _bytes -= it->second->code->size() + it->second->data->size();
+    _entries.erase(it->second);
+    _index.erase(it);
+}
+
+void CodeCache::insert(std::uint64_t key, const Blob& code, data_ptr data)
+{
+    auto it = _index.find(key);
+    if(it != _index.end())
+    {
+        _bytes -= it->second->code->size() + it->second->data->size();
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+
+    _bytes += code->size() + data->size();
+    _entries.push_front(Entry{key, code, std::move(data)});
+    _index.emplace(key, _entries.begin());
+    evict();
+}
+
+void CodeCache::use_file(const std::string& name, std::uintmax_t size)
+{
+    auto it = _fileIndex.find(name);
+    if(it != _fileIndex.end())
+    {
+        _fileBytes -= it->second->size;
+        it->second->size = size;
+        _files.splice(_files.begin(), _files, it->second);
+    } else {
+        _files.push_front(CacheFile{name, size});
+        _fileIndex.emplace(name, _files.begin());
+    }
+    _fileBytes += size;
+    evict();
+}
+
+void CodeCache::evict()
+{
+    while(_bytes > _capacity)
+    {
+        auto& last = _entries.back();
+        _bytes -= last.code->size() + last.data->size();
+        _index.erase(last.key);
+        _entries.pop_back();
+    }
+
+    while(_fileBytes > _capacity)
+    {
+        auto& last = _files.back();
+        boost::system::error_code ec;
+        boost::filesystem::remove(boost::filesystem::path(_directory) / last.name, ec);
+        if(ec)
+        {
+            SC_LOG(Warning, Scripting) << "failed to remove code cache file " << last.name << ": " << ec.message();
+        }
+        _fileBytes -= last.size;
+        _fileIndex.erase(last.name);
+        _files.pop_back();
+    }
+}
+
+std::string CodeCache::file_of(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), FileExtension);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return (boost::filesystem::path(_directory) / name).string();
+}
+
+// file layout: magic, source length, source, cache data.
+// The source is stored to tell apart scripts with the same hash.
+CodeCache::data_ptr CodeCache::load(std::uint64_t key, const std::string& code)
+{
+    auto file = file_of(key);
+    std::ifstream in(file, std::ios::binary);
+    if(!in)
+        return nullptr;
+
+    char magic[sizeof(FileMagic)];
+    std::uint64_t length = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if(!in || std::memcmp(magic, FileMagic, sizeof(magic)) || length != code.size())
+        return nullptr;
+
+    std::string source(code.size(), '\0');
+    in.read(&source[0], std::streamsize(source.size()));
+    if(!in || source != code)
+        return nullptr;
+
+    auto data = std::make_shared<const std::string>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    // the modification time keeps the order of use over restarts
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(file, std::time(nullptr), ec);
+    std::lock_guard<std::mutex> lock(_mutex);
+    use_file(boost::filesystem::path(file).filename().string(), FileHeaderSize + code.size() + data->size());
+    return data;
+}
+
+void CodeCache::save(std::uint64_t key, const std::string& code, const std::string& data)
+{
+    auto file = file_of(key);
+    // several workers may save the same script at once
+    auto tmp = file + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        std::uint64_t length = code.size();
+        out.write(FileMagic, sizeof(FileMagic));
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(code.data(), std::streamsize(code.size()));
+        out.write(data.data(), std::streamsize(data.size()));
+        if(!out)
+        {
+            SC_LOG(Warning, Scripting) << "failed to write code cache file " << tmp;
+            return;
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, file, ec);
+    if(ec)
+    {
+        SC_LOG(Warning, Scripting) << "failed to write code cache file " << file << ": " << ec.message();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    use_file(boost::filesystem::path(file).filename().string(), FileHeaderSize + code.size() + data.size());
+}
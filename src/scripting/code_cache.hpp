@@ -0,0 +1,98 @@
+#pragma once
+
+#include <v8.h>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/noncopyable.hpp>
+#include "objects/component/filesystem.hpp"
+
+// Compiled code shared between all isolates.
+// Scripts and modules are looked up by a hash of their source, so identical
+// code of a fleet is compiled once and every further compilation just
+// deserializes V8's code cache. If a directory is set, produced cache data is
+// also written there and reused after a restart.
+// Memory and directory are each bounded to a capacity in bytes, the least
+// recently used code is dropped first.
+class CodeCache: boost::noncopyable
+{
+public:
+    using Blob = FileSystem::Blob;
+
+    static const std::size_t DefaultCapacity = 64 * 1024 * 1024;
+
+    struct Stats
+    {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long rejected = 0;    // cache data V8 refused, e.g. from another V8 version
+    };
+
+    static CodeCache& Global();
+
+    // empty to keep the cache in memory only
+    void set_directory(const std::string& dir);
+    // bytes of sources and cache data kept in memory, and again in the directory
+    void set_capacity(std::size_t bytes);
+
+    // compiles the code in the current context of iso, thread safe
+    v8::MaybeLocal<v8::Script> compile(v8::Isolate* iso, v8::Local<v8::Context> ctx, const Blob& code);
+    // compiles an ES module, name is the origin shown in stack traces.
+    // V8 before 7.1 can't consume module caches, there modules are always compiled.
+    v8::MaybeLocal<v8::Module> compile_module(v8::Isolate* iso, const Blob& code, const std::string& name);
+
+    Stats stats() const;
+    // entries and their bytes in memory
+    std::size_t size() const;
+    std::size_t bytes() const;
+
+private:
+    using data_ptr = std::shared_ptr<const std::string>;
+
+    struct Entry
+    {
+        std::uint64_t key;
+        Blob code;          // shared with the file systems, not a copy
+        data_ptr data;
+    };
+
+    struct CacheFile
+    {
+        std::string name;
+        std::uintmax_t size;
+    };
+
+    data_ptr find(std::uint64_t key, const Blob& code);
+    void store(std::uint64_t key, const Blob& code, v8::ScriptCompiler::CachedData* data);
+    void erase(std::uint64_t key);
+
+    // all with _mutex locked
+    void insert(std::uint64_t key, const Blob& code, data_ptr data);
+    void use_file(const std::string& name, std::uintmax_t size);
+    void evict();
+
+    std::string file_of(std::uint64_t key) const;
+    data_ptr load(std::uint64_t key, const std::string& code);
+    void save(std::uint64_t key, const std::string& code, const std::string& data);
+
+private:
+    mutable std::mutex _mutex;
+    std::size_t _capacity = DefaultCapacity;
+
+    std::list<Entry> _entries{};                                        // most recently used first
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> _index{};
+    std::size_t _bytes = 0;
+
+    std::string _directory{};
+    std::list<CacheFile> _files{};                                      // most recently used first
+    std::unordered_map<std::string, std::list<CacheFile>::iterator> _fileIndex{};
+    std::uintmax_t _fileBytes = 0;
+
+    std::atomic<unsigned long long> _hits{0};
+    std::atomic<unsigned long long> _misses{0};
+    std::atomic<unsigned long long> _rejected{0};
+};
@@ -0,0 +1,44 @@
+#include "isolate_cache.hpp"
+
+#include <stdexcept>
+
+namespace {
+    v8::Local<v8::String> internalize(v8::Isolate* iso, const char* s)
+    {
+        v8::Local<v8::String> result;
+        if(!v8::String::NewFromUtf8(iso, s, v8::NewStringType::kInternalized).ToLocal(&result))
+            throw std::runtime_error("Failed to create string");
+        return result;
+    }
+}
+
+IsolateCache::IsolateCache(v8::Isolate* iso)
+    : _iso(iso)
+{
+    v8::HandleScope handle_scope(iso);
+    _x.Reset(iso, internalize(iso, "x"));
+    _y.Reset(iso, internalize(iso, "y"));
+}
+
+IsolateCache& IsolateCache::Create(v8::Isolate* iso)
+{
+    auto cache = new IsolateCache(iso);
+    iso->SetData(Slot, cache);
+    return *cache;
+}
+
+void IsolateCache::Destroy(v8::Isolate* iso)
+{
+    delete static_cast<IsolateCache*>(iso->GetData(Slot));
+    iso->SetData(Slot, nullptr);
+}
+
+v8::Local<v8::String> IsolateCache::x() const
+{
+    return _x.Get(_iso);
+}
+
+v8::Local<v8::String> IsolateCache::y() const
+{
+    return _y.Get(_iso);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <v8.h>
+#include <cstdint>
+#include <boost/noncopyable.hpp>
+
+// Handles that are the same in every context of an isolate, like the
+// property names the converters use, so they are not created per call.
+// Created on first use and kept in the isolate's data, so recycled isolates
+// keep theirs. ContextSnapshot destroys it before disposing the isolate.
+class IsolateCache: boost::noncopyable
+{
+public:
+    // isolate data slot, 0 is the processor owning the isolate
+    static const uint32_t Slot = 1;
+
+    static IsolateCache& Get(v8::Isolate* iso)
+    {
+        auto cache = static_cast<IsolateCache*>(iso->GetData(Slot));
+        return cache ? *cache : Create(iso);
+    }
+
+    // the isolate must not be used by another thread
+    static void Destroy(v8::Isolate* iso);
+
+    // internalized "x" and "y"
+    v8::Local<v8::String> x() const;
+    v8::Local<v8::String> y() const;
+
+private:
+    explicit IsolateCache(v8::Isolate* iso);
+    static IsolateCache& Create(v8::Isolate* iso);
+
+private:
+    v8::Isolate* _iso;
+    v8::Global<v8::String> _x;
+    v8::Global<v8::String> _y;
+};
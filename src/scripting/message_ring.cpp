@@ -0,0 +1,120 @@
+#include "message_ring.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace {
+    std::size_t round_up_pow2(std::size_t v)
+    {
+        std::size_t p = 1;
+        while(p < v)
+            p <<= 1;
+        return p;
+    }
+}
+
+MessageRing::MessageRing(std::size_t capacity)
+    : _mask(round_up_pow2(std::max<std::size_t>(capacity, 2)) - 1)
+    , _cells(new Cell[_mask + 1])
+{
+    for(std::size_t i = 0; i <= _mask; ++i)
+    {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+void MessageRing::push(ScriptMessage&& msg)
+{
+    assert(msg);
+    if(!_overflowing.load(std::memory_order_acquire) && try_push(msg))
+        return;
+
+    std::lock_guard<std::mutex> lock(_overflowMutex);
+    _overflow.push_back(std::move(msg));
+    _overflowing.store(true, std::memory_order_release);
+}
+
+bool MessageRing::try_push(ScriptMessage& msg)
+{
+    auto pos = _pushPos.load(std::memory_order_relaxed);
+    while(true)
+    {
+        auto& cell = _cells[pos & _mask];
+        auto seq = cell.sequence.load(std::memory_order_acquire);
+        auto diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+        if(diff == 0)
+        {
+            if(_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.msg = std::move(msg);
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if(diff < 0) {
+            // the consumer has not freed this cell yet
+            return false;
+        } else {
+            pos = _pushPos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MessageRing::pop(ScriptMessage& msg)
+{
+    while(true)
+    {
+        auto& cell = _cells[_popPos & _mask];
+        if(cell.sequence.load(std::memory_order_acquire) == _popPos + 1)
+        {
+            msg = std::move(cell.msg);
+            cell.sequence.store(_popPos + _mask + 1, std::memory_order_release);
+            ++_popPos;
+            return true;
+        }
+
+        if(_pushPos.load(std::memory_order_acquire) != _popPos)
+        {
+            // a producer claimed the cell but did not fill it yet
+            std::this_thread::yield();
+            continue;
+        }
+
+        if(!_overflowing.load(std::memory_order_acquire))
+            return false;
+
+        std::lock_guard<std::mutex> lock(_overflowMutex);
+        // The overflow only holds messages newer than anything in the ring.
+        // A producer pushed into the ring before it took the lock, so checking
+        // again under the lock sees every such push.
+        if(_pushPos.load(std::memory_order_acquire) != _popPos)
+            continue;
+        if(_overflowPos == _overflow.size())
+            return false;
+
+        msg = std::move(_overflow[_overflowPos++]);
+        if(_overflowPos == _overflow.size())
+        {
+            // keeps the capacity for the next burst
+            _overflow.clear();
+            _overflowPos = 0;
+            _overflowing.store(false, std::memory_order_release);
+        }
+        return true;
+    }
+}
+
+bool MessageRing::empty() const
+{
+    return _pushPos.load(std::memory_order_acquire) == _popPos
+        && !_overflowing.load(std::memory_order_acquire);
+}
+
+void MessageRing::clear()
+{
+    ScriptMessage msg;
+    while(pop(msg))
+    {
+        msg.reset();
+    }
+}
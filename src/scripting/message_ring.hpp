@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "script_message.hpp"
+
+// Bounded multi producer, single consumer queue of messages.
+// Messages live in preallocated cells, pushing and popping only moves them
+// in and out, so neither allocates. Each cell carries a sequence number
+// that tells producers and the consumer whose turn it is.
+// When the ring is full, messages go to an overflow list instead of being
+// dropped. Producers keep using the overflow until the consumer emptied it,
+// so the messages of one producer stay in order.
+class MessageRing: boost::noncopyable
+{
+public:
+    static const std::size_t DefaultCapacity = 64;
+
+    // capacity is rounded up to a power of two
+    explicit MessageRing(std::size_t capacity = DefaultCapacity);
+
+    // thread safe
+    void push(ScriptMessage&& msg);
+
+    // only one thread at a time may pop
+    bool pop(ScriptMessage& msg);
+    void clear();
+
+    // only reliable while nobody pops, pushes may happen concurrently
+    bool empty() const;
+
+private:
+    bool try_push(ScriptMessage& msg);
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        ScriptMessage msg;
+    };
+
+    const std::size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+    std::atomic<std::size_t> _pushPos{0};
+    std::size_t _popPos = 0;
+
+    std::atomic<bool> _overflowing{false};
+    std::mutex _overflowMutex;
+    std::vector<ScriptMessage> _overflow;
+    std::size_t _overflowPos = 0;
+};
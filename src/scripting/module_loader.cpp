@@ -0,0 +1,242 @@
+#include "module_loader.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <unordered_set>
+#include <utility>
+#include "binding.hpp"
+#include "code_cache.hpp"
+#include "log.hpp"
+
+namespace {
+    // path of the file spec resolves to, empty if there is none
+    std::string resolve(const FileSystem& files, boost::string_view cwd, boost::string_view spec)
+    {
+        try {
+            return files.open(cwd, spec).path;
+        } catch(const std::exception&)
+        {
+            return {};
+        }
+    }
+
+    // imports are relative to the directory of the importing module
+    boost::string_view dir_of(boost::string_view path)
+    {
+        return path.substr(0, path.rfind('/'));
+    }
+}
+
+ModuleLoader::ModuleLoader(v8::Isolate* iso, FileSystem files)
+    : _iso(iso)
+    , _files(std::move(files))
+{
+}
+
+void ModuleLoader::install(v8::Local<v8::Context> ctx)
+{
+    ctx->SetAlignedPointerInEmbedderData(bd::ModuleSlot, this);
+}
+
+ModuleLoader* ModuleLoader::FromContext(v8::Local<v8::Context> ctx)
+{
+    return reinterpret_cast<ModuleLoader*>(ctx->GetAlignedPointerFromEmbedderData(bd::ModuleSlot));
+}
+
+v8::MaybeLocal<v8::Value> ModuleLoader::run(v8::Local<v8::Context> ctx, boost::string_view path)
+{
+    v8::EscapableHandleScope handle_scope(_iso);
+
+    auto main = load("/", path);
+    if(!main)
+        return {};
+    _main = path.to_string();
+    _mainPath = main->first;
+
+    auto module = main->second.module.Get(_iso);
+    if(module->GetStatus() == v8::Module::kUninstantiated && !module->InstantiateModule(ctx, &ModuleLoader::Resolve).FromMaybe(false))
+        return {};
+
+    v8::Local<v8::Value> result;
+    if(!module->Evaluate(ctx).ToLocal(&result))
+        return {};
+    return handle_scope.Escape(result);
+}
+
+bool ModuleLoader::reload(v8::Local<v8::Context> ctx, FileSystem files)
+{
+    v8::HandleScope handle_scope(_iso);
+
+    // the last run has to have succeeded, there is nothing to keep otherwise
+    auto main = _modules.find(_mainPath);
+    if(main == _modules.end() || main->second.module.Get(_iso)->GetStatus() != v8::Module::kEvaluated)
+        return false;
+
+    _files = std::move(files);
+    auto stale = stale_modules();
+    if(stale.empty())
+        return true;
+
+    // every replaced module has to be stoppable, before any is stopped
+    auto unloadName = bd::toLocal(_iso, ctx, std::string("unload"));
+    std::vector<v8::Local<v8::Function>> unloads;
+    for(auto& path : stale)
+    {
+        auto module = _modules.at(path).module.Get(_iso);
+        auto status = module->GetStatus();
+        if(status == v8::Module::kUninstantiated)
+            continue;   // never ran
+
+        v8::Local<v8::Value> unload;
+        if(status != v8::Module::kEvaluated
+            || !module->GetModuleNamespace().As<v8::Object>()->Get(ctx, unloadName).ToLocal(&unload))
+            return false;
+        if(!unload->IsFunction())
+        {
+            SC_LOG(Debug, Scripting) << "module '" << path << "' exports no unload(), can not hot reload it";
+            return false;
+        }
+        unloads.push_back(unload.As<v8::Function>());
+    }
+
+    for(auto& unload : unloads)
+    {
+        if(unload->Call(ctx, v8::Undefined(_iso), 0, nullptr).IsEmpty())
+            return false;
+    }
+
+    for(auto& path : stale)
+    {
+        erase(path);
+    }
+    SC_LOG(Debug, Scripting) << "hot reloading " << stale.size() << " of " << (_modules.size() + stale.size()) << " modules";
+    return !run(ctx, _main).IsEmpty();
+}
+
+std::size_t ModuleLoader::modules() const
+{
+    return _modules.size();
+}
+
+ModuleLoader::entry_ptr ModuleLoader::load(boost::string_view cwd, boost::string_view path)
+{
+    FileSystem::File file;
+    try {
+        file = _files.open(cwd, path);
+    } catch(const std::exception& e)
+    {
+        auto msg = "Cannot find module '" + path.to_string() + "'";
+        _iso->ThrowException(v8::Exception::Error(bd::toLocal(_iso, _iso->GetCurrentContext(), msg).As<v8::String>()));
+        return nullptr;
+    }
+
+    auto it = _modules.find(file.path);
+    if(it != _modules.end() && it->second.code == file.code)
+        return &*it;
+
+    v8::Local<v8::Module> module;
+    if(!CodeCache::Global().compile_module(_iso, file.code, file.path).ToLocal(&module))
+        return nullptr;
+
+    // the file changed since it was compiled
+    if(it != _modules.end())
+        erase(file.path);
+
+    _paths.emplace(module->GetIdentityHash(), file.path);
+    auto& entry = *_modules.emplace(std::move(file.path), Entry{}).first;
+    entry.second.code = std::move(file.code);
+    entry.second.module.Reset(_iso, module);
+    return &entry;
+}
+
+ModuleLoader::entry_ptr ModuleLoader::entry_of(v8::Local<v8::Module> module)
+{
+    auto range = _paths.equal_range(module->GetIdentityHash());
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        auto& entry = *_modules.find(it->second);
+        if(entry.second.module == module)
+            return &entry;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> ModuleLoader::stale_modules() const
+{
+    std::unordered_set<std::string> stale;
+    for(auto& entry : _modules)
+    {
+        auto& path = entry.first;
+        bool changed = resolve(_files, "/", path) != path || _files.open("/", path).code != entry.second.code;
+        for(auto it = entry.second.imports.begin(); !changed && it != entry.second.imports.end(); ++it)
+        {
+            // e.g. a newer version of a '^' import was added
+            changed = resolve(_files, dir_of(path), it->first) != it->second;
+        }
+        if(changed)
+            stale.insert(path);
+    }
+
+    // the main module is replaced if the path now resolves to another file
+    if(resolve(_files, "/", _main) != _mainPath)
+        stale.insert(_mainPath);
+
+    // and so is every module importing a replaced one
+    bool grown = true;
+    while(grown)
+    {
+        grown = false;
+        for(auto& entry : _modules)
+        {
+            if(stale.count(entry.first))
+                continue;
+            for(auto& import : entry.second.imports)
+            {
+                if(stale.count(import.second))
+                {
+                    stale.insert(entry.first);
+                    grown = true;
+                    break;
+                }
+            }
+        }
+    }
+    return std::vector<std::string>(stale.begin(), stale.end());
+}
+
+void ModuleLoader::erase(const std::string& path)
+{
+    auto it = _modules.find(path);
+    assert(it != _modules.end());
+    v8::HandleScope handle_scope(_iso);
+    auto range = _paths.equal_range(it->second.module.Get(_iso)->GetIdentityHash());
+    for(auto p = range.first; p != range.second; ++p)
+    {
+        if(p->second == path)
+        {
+            _paths.erase(p);
+            break;
+        }
+    }
+    _modules.erase(it);
+}
+
+v8::MaybeLocal<v8::Module> ModuleLoader::Resolve(v8::Local<v8::Context> ctx, v8::Local<v8::String> specifier, v8::Local<v8::Module> referrer)
+{
+    auto loader = FromContext(ctx);
+    auto importer = loader->entry_of(referrer);
+    assert(importer);
+
+    v8::String::Utf8Value utf8(loader->_iso, specifier);
+    std::string spec(*utf8, utf8.length());
+    auto entry = loader->load(dir_of(importer->first), spec);
+    if(!entry)
+        return {};
+
+    auto& imports = importer->second.imports;
+    auto import = std::make_pair(std::move(spec), entry->first);
+    if(std::find(imports.begin(), imports.end(), import) == imports.end())
+        imports.push_back(std::move(import));
+    return entry->second.module.Get(loader->_iso);
+}
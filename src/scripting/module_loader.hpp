@@ -0,0 +1,73 @@
+#pragma once
+
+#include <v8.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/string_view.hpp>
+#include "objects/component/filesystem.hpp"
+
+// Loads ES modules from a ship's files.
+// Specifiers are paths into the FileSystem, relative to the importing module
+// unless they start with '/', and may use '^' to pick the newest version like
+// every other lookup, e.g. `import { go } from "./lib/nav-^.js"`.
+// Every file is compiled once per loader, so a module imported from several
+// places is shared by all of them. Compilation goes through CodeCache, so
+// the same file of another ship is only deserialized.
+//
+// The loader holds handles into its isolate, the processor owning the
+// context keeps it (Processor::attach) and destroys it with the context.
+class ModuleLoader: boost::noncopyable
+{
+public:
+    ModuleLoader(v8::Isolate* iso, FileSystem files);
+
+    // resolves the imports of modules in ctx, before any module is run there
+    void install(v8::Local<v8::Context> ctx);
+    static ModuleLoader* FromContext(v8::Local<v8::Context> ctx);
+
+    // Loads the module at path with all its imports and evaluates it.
+    // Empty if any of them fails, with the error thrown in ctx.
+    v8::MaybeLocal<v8::Value> run(v8::Local<v8::Context> ctx, boost::string_view path);
+
+    // Hot reload: runs the module of the last run() again with files, in
+    // the same context. Only modules whose file changed, whose imports now
+    // resolve to other files, or that import such a module are replaced,
+    // all others keep their state. A replaced module must export an
+    // `unload()` function that stops it, e.g. ends its loops, it is called
+    // before the new modules are evaluated.
+    // False if a module can't be replaced or anything fails, possibly with
+    // an error thrown in ctx. The context should be rebooted then.
+    bool reload(v8::Local<v8::Context> ctx, FileSystem files);
+
+    // number of compiled modules
+    std::size_t modules() const;
+
+private:
+    struct Entry
+    {
+        FileSystem::Blob code;          // the module was compiled from
+        v8::Global<v8::Module> module;
+        std::vector<std::pair<std::string, std::string>> imports{};    // specifier and path, once instantiated
+    };
+    using entry_ptr = std::pair<const std::string, Entry>*;
+
+    // the entry of the file at path, compiled if it isn't already
+    entry_ptr load(boost::string_view cwd, boost::string_view path);
+    entry_ptr entry_of(v8::Local<v8::Module> module);
+    // paths of the modules that have to be replaced to run with the current files
+    std::vector<std::string> stale_modules() const;
+    void erase(const std::string& path);
+
+    static v8::MaybeLocal<v8::Module> Resolve(v8::Local<v8::Context> ctx, v8::Local<v8::String> specifier, v8::Local<v8::Module> referrer);
+
+private:
+    v8::Isolate* _iso;
+    FileSystem _files;
+    std::unordered_map<std::string, Entry> _modules;            // by absolute path
+    std::unordered_multimap<int, std::string> _paths;           // by identity hash of the module
+    std::string _main;              // path given to the last run
+    std::string _mainPath;          // and the file it resolved to
+};
@@ -1,23 +1,26 @@
 #include "processor.hpp"
+#include "snapshot.hpp"
+#include "message_ring.hpp"
+#include "log.hpp"
 
 
-#include <cstdio>
-#include <cstdlib>
-#include <cstring>
+#include <cassert>
+#include <cstdint>
+#include <limits>
 
 #include <memory>
-#include <stack>
 #include <thread>
 #include <atomic>
-#include <future>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
-#include <stdexcept>
-#include <iostream>
+#include <algorithm>
 #include <string>
 #include <list>
+#include <vector>
 
-#include <boost/asio.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <pthread.h>
+#include <time.h>
 
 #include <v8.h>
 #include "libplatform/libplatform.h"
@@ -25,126 +28,271 @@
 
 using namespace v8;
 
+class V8Inst;
+class V8Manager;
 
+namespace {
+	using cpu_time = std::chrono::nanoseconds;
+
+	// how often running scripts are checked for overrunning their round
+	const auto WatchdogInterval = std::chrono::milliseconds(1);
+
+	cpu_time cpu_clock_now(clockid_t clock)
+	{
+		timespec ts;
+		clock_gettime(clock, &ts);
+		return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+	}
+
+	// cpu time consumed by the calling thread
+	cpu_time thread_cpu_now()
+	{
+		return cpu_clock_now(CLOCK_THREAD_CPUTIME_ID);
+	}
+
+	// A worker slot's share of the current round: indices into the round's
+	// processor list. The owner takes from the front, idle workers steal from
+	// the back. Both sides claim an index with a single CAS on the packed
+	// (round, begin, end) word, the round tag makes CASes on stale values fail.
+	class RoundRange
+	{
+	public:
+		static const std::uint32_t MaxIndex = (1u << 24) - 1;
+
+		// only while nobody can take from the range (between rounds)
+		void reset(std::uint32_t round, std::uint32_t begin, std::uint32_t end)
+		{
+			assert(begin <= end && end <= MaxIndex);
+			mRange.store(pack(round, begin, end), std::memory_order_release);
+		}
+
+		bool take_front(std::uint32_t& idx)
+		{
+			auto cur = mRange.load(std::memory_order_acquire);
+			while(begin_of(cur) < end_of(cur))
+			{
+				if(mRange.compare_exchange_weak(cur, pack(round_of(cur), begin_of(cur) + 1, end_of(cur)), std::memory_order_acq_rel))
+				{
+					idx = begin_of(cur);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool steal_back(std::uint32_t& idx)
+		{
+			auto cur = mRange.load(std::memory_order_acquire);
+			while(begin_of(cur) < end_of(cur))
+			{
+				if(mRange.compare_exchange_weak(cur, pack(round_of(cur), begin_of(cur), end_of(cur) - 1), std::memory_order_acq_rel))
+				{
+					idx = end_of(cur) - 1;
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		static std::uint64_t pack(std::uint64_t round, std::uint64_t begin, std::uint64_t end)
+		{
+			return ((round & 0xffff) << 48) | (begin << 24) | end;
+		}
+		static std::uint64_t round_of(std::uint64_t v) { return v >> 48; }
+		static std::uint32_t begin_of(std::uint64_t v) { return std::uint32_t((v >> 24) & MaxIndex); }
+		static std::uint32_t end_of(std::uint64_t v) { return std::uint32_t(v & MaxIndex); }
+
+	private:
+		std::atomic<std::uint64_t> mRange{0};
+	};
+
+	struct Worker
+	{
+		static const std::size_t NoSlot = std::size_t(-1);
+
+		std::thread thread;
+		std::size_t slot = NoSlot;				// only changed by the worker's own thread
+		std::atomic<V8Inst*> running{nullptr};	// read by the watchdog
+		clockid_t cpuClock;						// of the thread, set before anything runs on it
+	};
+
+	thread_local Worker* tCurrentWorker = nullptr;
+}
+
+
+// A script context in its own isolate. It has no thread of its own, the
+// manager's workers enter it with a Locker when it is scheduled for a round.
 class V8Inst : public Processor
 {
 public:
 	using init_func = V8ProcessorPool::init_func;
 
-	V8Inst(boost::asio::io_service& service, const boost::posix_time::milliseconds& roundtime, const std::function<void()>& finished,
-			std::promise<void> initPromise, const init_func& init_ctx)
-		: mTimer(service)
-		, mFinished(finished)
-		, mInitPromise(std::move(initPromise))
-        , mRoundTime(roundtime)
+	V8Inst(const std::shared_ptr<V8Manager>& manager, const ScriptBudget& budget, const std::shared_ptr<ContextSnapshot>& snapshot, const init_func& init_ctx)
+		: mManager(manager)
+		, mBudget(budget)
+		, mSnapshot(snapshot)
+		, mInitCtx(init_ctx)
 	{
-		mIsolateThread = std::thread(std::bind(&V8Inst::run, this, init_ctx));
 	}
 
-	~V8Inst() override
+	~V8Inst() override;
+
+	virtual void post_message(ScriptMessage&& msg) override
 	{
-		mQuit = true;
-		mIO.stop();
-		if(mRun)
-		{
-			mIsolate->TerminateExecution();
-		}
-		mCV.notify_all();
-		mIsolateThread.join();
+		mQueue.push(std::move(msg));
 	}
 
-	virtual void post(const msg_func& msg) override
+	virtual void attach(std::shared_ptr<void> obj) override
 	{
-		mIO.post(std::bind(&V8Inst::run_task, this, msg));
+		mAttached.push_back(std::move(obj));
 	}
 
-	void start_round()
+	virtual RoundStats stats() const override
 	{
-		std::lock_guard<std::mutex> lock(mLockMutex);
-		mRun = true;
-		mTimer.expires_from_now(mRoundTime);
-		mTimer.async_wait(std::bind(&V8Inst::run_interupt_requester, this));
-		mCV.notify_all();
+		return mStats;
 	}
 
-private:
-	void run(const init_func& init_ctx)
+	// has messages or a suspended script, only valid between rounds
+	bool ready() const
 	{
-		Isolate::CreateParams create_params;
-		create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
-		mIsolate = Isolate::New(create_params);
-		{
-			Isolate::Scope isolate_scope(mIsolate);
-			HandleScope handle_scope(mIsolate);
-			
-			{
-				auto ctx = init_ctx(mIsolate);
-				ctx->SetAlignedPointerInEmbedderData(1, this);
-				mContext.Reset(mIsolate, ctx);
-			}
+		return mSuspended.load(std::memory_order_acquire) || !mQueue.empty();
+	}
 
-			mRun = true;
-			mInitPromise.set_value();
-			bool finished_a_round = false;
-			while(!mQuit)
-			{
-				interupt(finished_a_round);
-				mIO.poll();
-				mIO.reset();
-				finished_a_round = true;
-			}
-		}
+	// a round without anything to do, on the game thread instead of a worker
+	void idle_round();
+
+	// computes the time this round may take, returns false if the processor
+	// has to sit out the round to pay off debt
+	bool begin_round();
+
+	// runs one round on the calling worker. Returns false if the processor
+	// was destroyed while the round was suspended.
+	bool run_round();
+
+	// hands the round to the thread this processor is suspended on, if any
+	bool resume_if_suspended();
+
+	// now is the cpu time of the thread running the processor
+	bool overdue(cpu_time now) const
+	{
+		return cpu_time(mCpuDeadline.load(std::memory_order_acquire)) <= now;
 	}
 
-	void run_task(const msg_func& f)
+	// called by the watchdog
+	void request_interrupt()
 	{
-		HandleScope handleScope(mIsolate);
-		auto ctx = Local<Context>::New(mIsolate, mContext);
-		Context::Scope context_scope(ctx);
-		f(mIsolate, ctx);
-		mIsolate->RunMicrotasks();
+		if(!mInterruptRequested.exchange(true, std::memory_order_relaxed))
+			mIsolate->RequestInterrupt(&V8Inst::on_interrupt, nullptr);
+	}
+
+	// signals the destructor that the suspended thread left the isolate
+	void exited()
+	{
+		std::lock_guard<std::mutex> lock(mSuspendMutex);
+		mExited = true;
+		mSuspendCV.notify_all();
 	}
 
-	void run_interupt_requester()
+private:
+	void init()
 	{
-		std::lock_guard<std::mutex> lock(mLockMutex);
-		if(mRun)
-			mIsolate->RequestInterrupt(&V8Inst::run_interupt, this);
+		mIsolate = mSnapshot->acquire(mBudget.heap_limit_mb);
+
+		Locker locker(mIsolate);
+		Isolate::Scope isolate_scope(mIsolate);
+		HandleScope handle_scope(mIsolate);
+		mIsolate->SetData(OwnerSlot, this);
+		mIsolate->AddNearHeapLimitCallback(&V8Inst::on_near_heap_limit, this);
+		auto ctx = mInitCtx(mIsolate);
+		ctx->SetAlignedPointerInEmbedderData(1, this);
+		mContext.Reset(mIsolate, ctx);
 	}
 
-	static void run_interupt(Isolate* isolate, void* inst)
+	// on the thread running the processor
+	void start_budget()
 	{
-		((V8Inst*)inst)->interupt(true);
+		mInterruptRequested = false;
+		mCpuStart = thread_cpu_now();
+		mCpuDeadline.store((mCpuStart + mAllowance).count(), std::memory_order_release);
 	}
 
-	void interupt(bool finished)
+	void end_budget(bool suspended)
 	{
-		std::unique_lock<std::mutex> lock(mLockMutex);
-		if(!mRun)
-			return;
-		mTimer.cancel();
-		if(finished)
-			mFinished();
-		mRun = false;
-		mCV.wait(lock, [this]{ return mRun || mQuit; });
+		auto used = thread_cpu_now() - mCpuStart;
+		mCpuDeadline.store(std::numeric_limits<cpu_time::rep>::max(), std::memory_order_relaxed);
+		mStats.cpu_time = used;
+		mStats.allowance = mAllowance;
+		mStats.balance = std::max<cpu_time>(-mBudget.max_debt, std::min<cpu_time>(mBudget.max_credit, mAllowance - used));
+		if(suspended)
+			++mStats.suspended;
+
+		HeapStatistics heap;
+		mIsolate->GetHeapStatistics(&heap);
+		mStats.heap_used = heap.used_heap_size();
+		mStats.heap_limit = heap.heap_size_limit();
+	}
+
+	void drop_tasks()
+	{
+		mQueue.clear();
+	}
+
+	// Isolates are recycled, so an interrupt requested shortly before a
+	// processor was destroyed may fire for the next one. The owner is looked
+	// up when the interrupt runs instead of being passed along.
+	static void on_interrupt(Isolate* isolate, void*)
+	{
+		if(auto inst = static_cast<V8Inst*>(isolate->GetData(OwnerSlot)))
+			inst->suspend_if_overdue();
 	}
 
+	void suspend_if_overdue();
+
+	// called during gc on the thread running the processor. Terminates the
+	// script and raises the limit just enough to let it unwind, only this
+	// processor dies instead of the whole process.
+	static size_t on_near_heap_limit(void* inst, size_t current_limit, size_t initial_limit)
+	{
+		auto& self = *static_cast<V8Inst*>(inst);
+		if(!self.mStats.out_of_memory)
+		{
+			SC_LOG(Warning, Scripting) << "processor reached its heap limit of " << initial_limit / (1024 * 1024) << "mb, terminating it";
+			self.mStats.out_of_memory = true;
+			self.mIsolate->TerminateExecution();
+		}
+		return current_limit + initial_limit / 2;
+	}
 
 private:
-	boost::asio::io_service mIO;
-	std::thread mIsolateThread;
-	Isolate* mIsolate;
-	Persistent<Context> mContext;
+	// isolate data slot holding the processor using the isolate
+	static const uint32_t OwnerSlot = 0;
 
-    const boost::posix_time::milliseconds mRoundTime;
-	boost::asio::deadline_timer mTimer;
-	std::mutex mLockMutex;
-	std::condition_variable mCV;
-	std::atomic<bool> mRun{false};
-	std::atomic<bool> mQuit{false};
+	const std::shared_ptr<V8Manager> mManager;
+	const ScriptBudget mBudget;
+	const std::shared_ptr<ContextSnapshot> mSnapshot;
+	const init_func mInitCtx;
 
-	std::promise<void> mInitPromise;
-	std::function<void()> mFinished;
+	Isolate* mIsolate = nullptr;
+	Persistent<Context> mContext;
+	std::vector<std::shared_ptr<void>> mAttached;	// destroyed before the context
+
+	MessageRing mQueue;
+
+	RoundStats mStats;
+	cpu_time mAllowance{};
+	cpu_time mCpuStart{};
+	// never overdue outside of a round, the isolate might not even exist yet
+	std::atomic<cpu_time::rep> mCpuDeadline{std::numeric_limits<cpu_time::rep>::max()};
+	std::atomic<bool> mInterruptRequested{false};
+
+	// a script that overran its round keeps its thread until it is resumed
+	std::mutex mSuspendMutex;
+	std::condition_variable mSuspendCV;
+	std::atomic<bool> mSuspended{false};	// changed under mSuspendMutex, read without it by ready()
+	bool mResume = false;
+	bool mQuit = false;
+	bool mExited = false;
 };
 
 
@@ -154,95 +302,411 @@ Processor* Processor::FromContext(const v8::Local<v8::Context>& ctx)
 }
 
 
-class V8Manager : public V8ProcessorPool
+// Multiplexes all processors onto a fixed number of worker threads.
+// Every update_all is one round: each processor with pending messages runs
+// them until it used up the cpu time of its ScriptBudget, idle processors are
+// not scheduled at all. The processors of a round are split into one range
+// per worker slot, workers that run out of work steal from the other ranges.
+// A script that is still running when its budget is up is suspended on its
+// thread until the next round, and a spare thread takes over the slot, so
+// only overrunning scripts ever cost an extra thread.
+class V8Manager : public V8ProcessorPool, public std::enable_shared_from_this<V8Manager>
 {
+	friend class V8Inst;
 public:
-	using work = boost::asio::io_service::work;
 	V8Manager(unsigned int numThreads)
-		: mThreadCount(numThreads)
-	{
-	}
-	
-	~V8Manager()
+		: mSlots(std::max(1u, numThreads))
 	{
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		for(std::size_t i = 0; i < mSlots.size(); ++i)
+		{
+			mFreeSlots.push_back(i);
+			spawn_worker();
+		}
+		mWatchdog = std::thread(&V8Manager::run_watchdog, this);
 	}
 
-	virtual std::shared_ptr<Processor> newProcessor(std::chrono::milliseconds processingTimePerStep, const init_func& init_ctx) override
+	~V8Manager()
 	{
-		std::promise<void> initP{};
-		mInitFutures.emplace(initP.get_future());
-        boost::posix_time::milliseconds procTime(processingTimePerStep.count());
-		auto inst = std::make_shared<V8Inst>(mIO, procTime, std::bind(&V8Manager::do_task, this), std::move(initP), init_ctx);
+		{
+			std::lock_guard<std::mutex> lock(mIdleMutex);
+			mQuit = true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mThreadsMutex);
+			mSpareCV.notify_all();
+		}
+		mIdleCV.notify_all();
 
+		mWatchdog.join();
+		for(auto& w : mWorkers)
 		{
-            mInsts.push_back(inst);
+			w.thread.join();
 		}
+	}
 
+	virtual std::shared_ptr<Processor> newProcessor(const ScriptBudget& budget, const std::shared_ptr<ContextSnapshot>& snapshot, const init_func& init_ctx) override
+	{
+		auto inst = std::make_shared<V8Inst>(shared_from_this(), budget, snapshot, init_ctx);
+		mInsts.push_back(inst);
 		return inst;
 	}
 
 	virtual void update_all() override
 	{
-		while(mInitFutures.size())
+		// only processors with something to do take part in the round,
+		// idle ones are accounted for right here without waking any thread
+		mRound.clear();
+		mMemoryStats = MemoryStats{};
+		auto it = std::remove_if(mInsts.begin(), mInsts.end(), [this](const std::weak_ptr<V8Inst>& weak)
 		{
-			mInitFutures.top().wait();
-			mInitFutures.pop();
-		}
+			auto inst = weak.lock();
+			if(!inst)
+				return true;
+			if(inst->ready())
+			{
+				mRound.push_back(std::move(inst));
+			} else {
+				inst->idle_round();
+				add_memory_stats(*inst);
+			}
+			return false;
+		});
+		mInsts.erase(it, mInsts.end());
+
+		if(mRound.empty())
+			return;
+		assert(mRound.size() <= RoundRange::MaxIndex);
 
-		mIO.reset();
-		//mWork = std::make_unique<work>(std::ref(mIO));
-		mIt = mInsts.begin();
+		const auto count = std::uint32_t(mRound.size());
+		const auto slots = std::uint32_t(mSlots.size());
+		const auto round = mEpoch.load(std::memory_order_relaxed) + 1;
+		mRemaining.store(count, std::memory_order_relaxed);
+		for(std::uint32_t s = 0; s < slots; ++s)
+		{
+			mSlots[s].reset(round, std::uint64_t(count) * s / slots, std::uint64_t(count) * (s + 1) / slots);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mIdleMutex);
+			mEpoch.store(round, std::memory_order_release);
+		}
+		mIdleCV.notify_all();
 
-		for(unsigned int i = 0; i < mThreadCount; ++i)
 		{
-			post_task();
+			std::unique_lock<std::mutex> lock(mDoneMutex);
+			mDoneCV.wait(lock, [this]{ return mRemaining.load(std::memory_order_acquire) == 0; });
+		}
+		for(const auto& inst : mRound)
+		{
+			add_memory_stats(*inst);
 		}
-		mIO.run();
-		assert(mIt == mInsts.end());
+		mRound.clear();
+	}
+
+	virtual MemoryStats memory_stats() const override
+	{
+		return mMemoryStats;
 	}
 
 private:
-	void post_task()
+	void add_memory_stats(const V8Inst& inst)
 	{
-		mIO.post(std::bind(&V8Manager::do_task, this));
+		auto stats = inst.stats();
+		++mMemoryStats.processors;
+		mMemoryStats.heap_used += stats.heap_used;
+		mMemoryStats.largest_heap = std::max(mMemoryStats.largest_heap, stats.heap_used);
+		if(stats.out_of_memory)
+			++mMemoryStats.out_of_memory;
 	}
 
-	void do_task()
+	// mThreadsMutex must be held
+	void spawn_worker()
 	{
-		std::shared_ptr<V8Inst> inst;
-        while(!inst)
-        {
-			std::lock_guard<std::mutex> lock(mTaskMutex);
+		mWorkers.emplace_back();
+		auto& w = mWorkers.back();
+		w.thread = std::thread(&V8Manager::run_worker, this, std::ref(w));
+	}
 
-			if(mIt == mInsts.end())
+	void run_worker(Worker& w)
+	{
+		tCurrentWorker = &w;
+		pthread_getcpuclockid(pthread_self(), &w.cpuClock);
+		while(true)
+		{
 			{
+				std::unique_lock<std::mutex> lock(mThreadsMutex);
+				++mSpareThreads;
+				mSpareCV.wait(lock, [this]{ return mQuit || !mFreeSlots.empty(); });
+				--mSpareThreads;
+				if(mQuit)
+					return;
+				w.slot = mFreeSlots.back();
+				mFreeSlots.pop_back();
+			}
+			run_slot(w);
+			if(mQuit)
 				return;
+		}
+	}
+
+	// works for a slot until the thread gets suspended with a script
+	void run_slot(Worker& w)
+	{
+		while(w.slot != Worker::NoSlot && !mQuit)
+		{
+			auto seen = mEpoch.load(std::memory_order_acquire);
+			std::uint32_t idx;
+			if(take(w.slot, idx))
+			{
+				run(w, *mRound[idx]);
+				continue;
 			}
 
-            inst = *mIt;
+			std::unique_lock<std::mutex> lock(mIdleMutex);
+			mIdleCV.wait(lock, [this, seen]{ return mQuit || mEpoch.load(std::memory_order_relaxed) != seen; });
+		}
+	}
+
+	bool take(std::size_t slot, std::uint32_t& idx)
+	{
+		if(mSlots[slot].take_front(idx))
+			return true;
+		for(std::size_t i = 1; i < mSlots.size(); ++i)
+		{
+			if(mSlots[(slot + i) % mSlots.size()].steal_back(idx))
+				return true;
+		}
+		return false;
+	}
+
+	void run(Worker& w, V8Inst& inst)
+	{
+		if(!inst.begin_round())
+		{
+			finish_round();
+			return;
+		}
+		if(inst.resume_if_suspended())
+			return;
 
-            if(inst)
-            {
-                ++mIt;
-            }else{
-                mIt = mInsts.erase(mIt);
-            }
+		w.running.store(&inst, std::memory_order_release);
+		bool finished = inst.run_round();
+		w.running.store(nullptr, std::memory_order_release);
+		if(finished)
+		{
+			finish_round();
+		} else {
+			inst.exited();
+		}
+	}
 
+	void finish_round()
+	{
+		if(mRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(mDoneMutex);
+			mDoneCV.notify_all();
 		}
+	}
+
+	// the current thread stays with a suspended script, another one takes over its slot
+	void detach_current_worker()
+	{
+		auto& w = *tCurrentWorker;
+		w.running.store(nullptr, std::memory_order_release);
+
+		// a thread resumed with its script has no slot anymore
+		if(w.slot == Worker::NoSlot)
+			return;
+
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		mFreeSlots.push_back(w.slot);
+		w.slot = Worker::NoSlot;
+		if(mFreeSlots.size() > mSpareThreads)
+			spawn_worker();
+		mSpareCV.notify_one();
+	}
+
+	void run_watchdog()
+	{
+		while(true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mIdleMutex);
+				mIdleCV.wait(lock, [this]{ return mQuit || mRemaining.load(std::memory_order_relaxed); });
+				if(mQuit)
+					return;
+			}
 
-        inst->start_round();
+			std::this_thread::sleep_for(WatchdogInterval);
+			std::lock_guard<std::mutex> lock(mThreadsMutex);
+			for(auto& w : mWorkers)
+			{
+				auto inst = w.running.load(std::memory_order_acquire);
+				if(inst && inst->overdue(cpu_clock_now(w.cpuClock)))
+					inst->request_interrupt();
+			}
+		}
 	}
 
 private:
-	const unsigned int mThreadCount;
-	std::list<std::shared_ptr<V8Inst>>::iterator mIt;
-	std::mutex mTaskMutex;
-	std::unique_ptr<work> mWork;
-	std::list<std::shared_ptr<V8Inst>> mInsts;
-	boost::asio::io_service mIO;
-	std::stack<std::future<void>> mInitFutures;
+	// only used by the game thread
+	std::vector<std::weak_ptr<V8Inst>> mInsts;
+	std::vector<std::shared_ptr<V8Inst>> mRound;
+	MemoryStats mMemoryStats;
+
+	std::vector<RoundRange> mSlots;
+	std::atomic<std::uint32_t> mEpoch{0};
+	std::atomic<std::size_t> mRemaining{0};
+	std::atomic<bool> mQuit{false};
+
+	std::mutex mIdleMutex;
+	std::condition_variable mIdleCV;
+	std::mutex mDoneMutex;
+	std::condition_variable mDoneCV;
+
+	// guards the worker list and slot assignment, taken only when threads change roles
+	std::mutex mThreadsMutex;
+	std::condition_variable mSpareCV;
+	std::list<Worker> mWorkers;
+	std::vector<std::size_t> mFreeSlots;
+	std::size_t mSpareThreads = 0;
+
+	std::thread mWatchdog;
 };
 
+
+V8Inst::~V8Inst()
+{
+	if(!mIsolate)
+		return;
+
+	// an isolate that ran out of memory is left with a raised heap limit
+	bool terminated = mStats.out_of_memory;
+	{
+		std::unique_lock<std::mutex> lock(mSuspendMutex);
+		if(mSuspended)
+		{
+			// unwind the script on the thread it is suspended on
+			mQuit = true;
+			mIsolate->TerminateExecution();
+			terminated = true;
+			mSuspendCV.notify_all();
+			mSuspendCV.wait(lock, [this]{ return mExited; });
+		}
+	}
+
+	// the watchdog must not be looking at this processor anymore
+	{
+		std::lock_guard<std::mutex> lock(mManager->mThreadsMutex);
+	}
+
+	{
+		Locker locker(mIsolate);
+		Isolate::Scope isolate_scope(mIsolate);
+		mAttached.clear();
+		mContext.Reset();
+		mIsolate->SetData(OwnerSlot, nullptr);
+		mIsolate->RemoveNearHeapLimitCallback(&V8Inst::on_near_heap_limit, 0);
+		mIsolate->ContextDisposedNotification();
+	}
+	mSnapshot->release(mIsolate, mBudget.heap_limit_mb, !terminated);
+}
+
+bool V8Inst::run_round()
+{
+	if(!mIsolate)
+		init();
+
+	Locker locker(mIsolate);
+	Isolate::Scope isolate_scope(mIsolate);
+	// all messages of the round share one scope, handles live until the round ends
+	HandleScope handle_scope(mIsolate);
+	auto ctx = Local<Context>::New(mIsolate, mContext);
+	Context::Scope context_scope(ctx);
+
+	start_budget();
+	ScriptMessage task;
+	// mQuit is checked after the microtasks too, a script suspended in them
+	// was terminated by the destructor, but V8 cleared that on unwinding
+	while(!mQuit && !mStats.out_of_memory && !overdue(thread_cpu_now()) && mQueue.pop(task))
+	{
+		task(mIsolate, ctx);
+		task.reset();
+		if(mQuit)
+			return false;
+		mIsolate->RunMicrotasks();
+	}
+	if(mQuit)
+		return false;
+	end_budget(false);
+	return true;
+}
+
+void V8Inst::idle_round()
+{
+	++mStats.rounds;
+	++mStats.idle;
+	mStats.cpu_time = cpu_time::zero();
+	mStats.allowance = mBudget.per_round + mStats.balance;
+	mStats.balance = std::min<cpu_time>(mBudget.max_credit, mStats.allowance);
+}
+
+bool V8Inst::begin_round()
+{
+	++mStats.rounds;
+	if(mStats.out_of_memory)
+	{
+		drop_tasks();
+		mStats.cpu_time = cpu_time::zero();
+		return false;
+	}
+
+	mAllowance = mBudget.per_round + mStats.balance;
+	if(mAllowance > cpu_time::zero())
+		return true;
+
+	++mStats.skipped;
+	mStats.cpu_time = cpu_time::zero();
+	mStats.allowance = mAllowance;
+	mStats.balance = mAllowance;
+	return false;
+}
+
+bool V8Inst::resume_if_suspended()
+{
+	std::lock_guard<std::mutex> lock(mSuspendMutex);
+	if(!mSuspended)
+		return false;
+	mResume = true;
+	mSuspendCV.notify_all();
+	return true;
+}
+
+void V8Inst::suspend_if_overdue()
+{
+	mInterruptRequested = false;
+	if(!overdue(thread_cpu_now()))
+		return;
+
+	end_budget(true);
+	std::unique_lock<std::mutex> lock(mSuspendMutex);
+	// must be visible before the round ends, the next round resumes instead of entering the isolate
+	mSuspended = true;
+	mManager->detach_current_worker();
+	mManager->finish_round();
+
+	mSuspendCV.wait(lock, [this]{ return mResume || mQuit; });
+	mSuspended = false;
+	mResume = false;
+	if(mQuit)
+		return;
+
+	tCurrentWorker->running.store(this, std::memory_order_release);
+	start_budget();
+}
+
+
 namespace {
 	struct V8Initializer
 	{
@@ -259,6 +723,18 @@ namespace {
 	};
 }
 
+std::shared_ptr<Processor> V8ProcessorPool::newProcessor(const ScriptBudget& budget, const init_func& init_ctx)
+{
+	return newProcessor(budget, ContextSnapshot::Default(), init_ctx);
+}
+
+std::shared_ptr<Processor> V8ProcessorPool::newProcessor(std::chrono::milliseconds processingTimePerStep, const init_func& init_ctx)
+{
+	ScriptBudget budget;
+	budget.per_round = processingTimePerStep;
+	return newProcessor(budget, init_ctx);
+}
+
 std::shared_ptr<V8ProcessorPool> V8ProcessorPool::Create(unsigned int parallelThreads)
 {
 	static V8Initializer initializer{};
@@ -2,15 +2,50 @@
 
 #include <v8.h>
 #include <chrono>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include "script_budget.hpp"
+#include "script_message.hpp"
+
+class ContextSnapshot;
 
 class Processor
 {
 public:
 	using msg_func = std::function<void(v8::Isolate*, v8::Local<v8::Context>&)>;
 
+	struct RoundStats
+	{
+		std::chrono::nanoseconds cpu_time{};	// used in the last round
+		std::chrono::nanoseconds allowance{};	// of the last round, budget plus carried over balance
+		std::chrono::nanoseconds balance{};		// credit (positive) or debt carried into the next round
+		unsigned long long rounds = 0;
+		unsigned long long skipped = 0;			// rounds sat out because of debt
+		unsigned long long idle = 0;			// rounds without messages, the processor was not scheduled
+		unsigned long long suspended = 0;		// rounds that ended with the script still running
+		std::size_t heap_used = 0;				// sampled at the end of the last round
+		std::size_t heap_limit = 0;
+		bool out_of_memory = false;				// terminated for reaching the heap limit, runs no more messages
+	};
+
     virtual ~Processor() = default;
-    virtual void post(const msg_func& msg) = 0;
+
+    // msg is any callable taking (Isolate*, Local<Context>&), small ones are posted without allocating
+    template<typename F>
+    void post(F&& msg)
+    {
+        post_message(ScriptMessage(std::forward<F>(msg)));
+    }
+    virtual void post_message(ScriptMessage&& msg) = 0;
+
+	// only valid between rounds
+	virtual RoundStats stats() const = 0;
+
+	// Ties obj to the processor's context, for objects holding handles into it.
+	// It is destroyed with the context, under the lock of the isolate.
+	// Only from the processor's own messages.
+	virtual void attach(std::shared_ptr<void> obj) = 0;
 
     static Processor* FromContext(const v8::Local<v8::Context>& ctx);
 };
@@ -19,10 +54,24 @@ class V8ProcessorPool
 {
 public:
     using init_func = std::function<v8::Local<v8::Context>(v8::Isolate*)>;
+
+    struct MemoryStats
+    {
+        std::size_t processors = 0;
+        std::size_t heap_used = 0;          // of all processors
+        std::size_t largest_heap = 0;       // heap_used of the processor using the most
+        std::size_t out_of_memory = 0;      // processors terminated for reaching their heap limit
+    };
+
     virtual ~V8ProcessorPool() = default;
 
     virtual void update_all() = 0;
-    virtual std::shared_ptr<Processor> newProcessor(std::chrono::milliseconds processingTimePerStep, const init_func& init_ctx) = 0;
+    // of the processors in the last round, only valid between rounds
+    virtual MemoryStats memory_stats() const = 0;
+    // init_ctx runs in an isolate deserialized from snapshot, Context::New gives the snapshot's context
+    virtual std::shared_ptr<Processor> newProcessor(const ScriptBudget& budget, const std::shared_ptr<ContextSnapshot>& snapshot, const init_func& init_ctx) = 0;
+    std::shared_ptr<Processor> newProcessor(const ScriptBudget& budget, const init_func& init_ctx);
+    std::shared_ptr<Processor> newProcessor(std::chrono::milliseconds processingTimePerStep, const init_func& init_ctx);
 
     static std::shared_ptr<V8ProcessorPool> Create(unsigned int parallelThreads);
-};
\ No newline at end of file
+};
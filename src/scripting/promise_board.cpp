@@ -0,0 +1,76 @@
+#include "promise_board.hpp"
+
+#include <algorithm>
+#include <utility>
+#include "processor.hpp"
+
+void PromiseBoard::Install(v8::Local<v8::Context> ctx)
+{
+    // the map is created in the context it belongs to
+    v8::Context::Scope context_scope(ctx);
+    ctx->SetEmbedderData(bd::PromiseSlot, v8::Map::New(ctx->GetIsolate()));
+}
+
+v8::Local<v8::Promise> PromiseBoard::add(v8::Local<v8::Context> ctx, check_func check)
+{
+    auto iso = ctx->GetIsolate();
+    auto resolver = bd::unwrap(v8::Promise::Resolver::New(ctx), "Failed to create promise");
+    auto pending = ctx->GetEmbedderData(bd::PromiseSlot).As<v8::Map>();
+
+    auto id = _nextId++;
+    bd::unwrap(pending->Set(ctx, v8::Integer::NewFromUnsigned(iso, id), resolver), "Failed to store promise");
+    _entries.push_back(Entry{id, std::move(check)});
+    return resolver->GetPromise();
+}
+
+void PromiseBoard::settle(Processor& proc)
+{
+    std::vector<std::pair<std::uint32_t, Outcome>> settled;
+    auto it = std::remove_if(_entries.begin(), _entries.end(), [&settled](Entry& entry)
+    {
+        auto outcome = entry.check();
+        if(!outcome)
+            return false;
+        settled.emplace_back(entry.id, std::move(*outcome));
+        return true;
+    });
+    _entries.erase(it, _entries.end());
+
+    if(settled.empty())
+        return;
+
+    proc.post([settled = std::move(settled)](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+    {
+        auto pending = ctx->GetEmbedderData(bd::PromiseSlot).As<v8::Map>();
+        for(auto& s : settled)
+        {
+            auto key = v8::Integer::NewFromUnsigned(iso, s.first);
+            v8::Local<v8::Value> resolver;
+            if(!pending->Get(ctx, key).ToLocal(&resolver) || resolver->IsUndefined())
+                continue;
+            pending->Delete(ctx, key).FromJust();
+
+            auto& outcome = s.second;
+            auto value = outcome.value ? outcome.value(iso, ctx) : v8::Undefined(iso).As<v8::Value>();
+            if(outcome.rejected)
+            {
+                resolver.As<v8::Promise::Resolver>()->Reject(ctx, value).FromJust();
+            } else {
+                resolver.As<v8::Promise::Resolver>()->Resolve(ctx, value).FromJust();
+            }
+        }
+    });
+}
+
+std::size_t PromiseBoard::pending() const
+{
+    return _entries.size();
+}
+
+PromiseBoard::Outcome PromiseBoard::Reject(const std::string& message)
+{
+    return Outcome{true, [message](v8::Isolate* iso, v8::Local<v8::Context> ctx)
+    {
+        return v8::Exception::Error(bd::toLocal(iso, ctx, message).As<v8::String>());
+    }};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <v8.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
+#include "binding.hpp"
+
+class Processor;
+
+// Promises handed out to a script and settled by the game loop.
+// A script asks for something that takes time, like a ship arriving at its
+// target, and gets a promise plus a check that is remembered on the board.
+// Once per tick, between rounds, the game runs all checks and settles the
+// promises that are done with a single message to the processor.
+// A script awaiting such a promise posts nothing and uses no cpu time.
+//
+// The resolvers are kept in a map in the context itself (bd::PromiseSlot),
+// so the board holds no V8 handles and can live on the game thread.
+class PromiseBoard: boost::noncopyable
+{
+public:
+    using value_func = std::function<v8::Local<v8::Value>(v8::Isolate*, v8::Local<v8::Context>)>;
+
+    struct Outcome
+    {
+        bool rejected = false;
+        value_func value{};         // undefined if empty
+    };
+
+    // runs on the game thread, returns an outcome once the promise can be settled
+    using check_func = std::function<boost::optional<Outcome>()>;
+
+    // prepares a new context for promises, before any are added
+    static void Install(v8::Local<v8::Context> ctx);
+
+    // in the processor's context during a round
+    v8::Local<v8::Promise> add(v8::Local<v8::Context> ctx, check_func check);
+
+    // on the game thread between rounds
+    void settle(Processor& proc);
+
+    std::size_t pending() const;
+
+    template<typename T>
+    static Outcome Resolve(T value)
+    {
+        return Outcome{false, [value](v8::Isolate* iso, v8::Local<v8::Context> ctx)
+        {
+            return bd::toLocal(iso, ctx, value);
+        }};
+    }
+
+    static Outcome Reject(const std::string& message);
+
+private:
+    struct Entry
+    {
+        std::uint32_t id;
+        check_func check;
+    };
+
+    std::vector<Entry> _entries{};
+    std::uint32_t _nextId = 0;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// CPU time a processor may use, measured per thread, so it does not depend on
+// how busy the machine is. Time not used in a round is carried over as
+// credit, time used beyond the budget as debt. A processor in debt sits out
+// rounds until its debt is paid off.
+// The heap of a processor's isolate is limited as well, a processor that
+// reaches the limit is terminated instead of taking the process down.
+struct ScriptBudget
+{
+    std::chrono::microseconds per_round{10000};
+    std::chrono::microseconds max_credit{10000};
+    std::chrono::microseconds max_debt{50000};
+    std::size_t heap_limit_mb = 64;     // old space of the isolate, 0 for V8's default
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <v8.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A message for a processor, any callable taking (Isolate*, Local<Context>&).
+// Callables up to InlineSize bytes are stored in the message itself, so
+// posting them allocates nothing. Larger ones are moved to the heap.
+class ScriptMessage
+{
+public:
+    static const std::size_t InlineSize = 48;
+
+    ScriptMessage() = default;
+
+    template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, ScriptMessage>::value>::type>
+    ScriptMessage(F&& func)
+    {
+        using T = typename std::decay<F>::type;
+        emplace<T>(std::forward<F>(func), std::integral_constant<bool, fits_inline<T>()>());
+    }
+
+    ScriptMessage(ScriptMessage&& other)
+    {
+        take(other);
+    }
+
+    ScriptMessage& operator =(ScriptMessage&& other)
+    {
+        if(this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ScriptMessage(const ScriptMessage&) = delete;
+    ScriptMessage& operator =(const ScriptMessage&) = delete;
+
+    ~ScriptMessage()
+    {
+        reset();
+    }
+
+    explicit operator bool() const
+    {
+        return _ops != nullptr;
+    }
+
+    void operator ()(v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+    {
+        _ops->call(&_storage, iso, ctx);
+    }
+
+    void reset()
+    {
+        if(_ops)
+        {
+            _ops->destroy(&_storage);
+            _ops = nullptr;
+        }
+    }
+
+private:
+    using storage_type = typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type;
+
+    struct Ops
+    {
+        void (*call)(void* storage, v8::Isolate* iso, v8::Local<v8::Context>& ctx);
+        void (*move)(void* from, void* to);     // leaves from destroyed
+        void (*destroy)(void* storage);
+    };
+
+    template<typename T>
+    static constexpr bool fits_inline()
+    {
+        return sizeof(T) <= InlineSize
+            && alignof(storage_type) % alignof(T) == 0
+            && std::is_nothrow_move_constructible<T>::value;
+    }
+
+    template<typename T, typename F>
+    void emplace(F&& func, std::true_type /* inline */)
+    {
+        static const Ops ops = {
+            [](void* s, v8::Isolate* iso, v8::Local<v8::Context>& ctx) { (*static_cast<T*>(s))(iso, ctx); },
+            [](void* from, void* to) { new(to) T(std::move(*static_cast<T*>(from))); static_cast<T*>(from)->~T(); },
+            [](void* s) { static_cast<T*>(s)->~T(); }
+        };
+        new(&_storage) T(std::forward<F>(func));
+        _ops = &ops;
+    }
+
+    template<typename T, typename F>
+    void emplace(F&& func, std::false_type /* inline */)
+    {
+        static const Ops ops = {
+            [](void* s, v8::Isolate* iso, v8::Local<v8::Context>& ctx) { (**static_cast<T**>(s))(iso, ctx); },
+            [](void* from, void* to) { *static_cast<T**>(to) = *static_cast<T**>(from); },
+            [](void* s) { delete *static_cast<T**>(s); }
+        };
+        *reinterpret_cast<T**>(&_storage) = new T(std::forward<F>(func));
+        _ops = &ops;
+    }
+
+    void take(ScriptMessage& other)
+    {
+        if(other._ops)
+        {
+            other._ops->move(&other._storage, &_storage);
+            _ops = other._ops;
+            other._ops = nullptr;
+        }
+    }
+
+private:
+    storage_type _storage;
+    const Ops* _ops = nullptr;
+};
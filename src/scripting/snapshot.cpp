@@ -0,0 +1,113 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include "isolate_cache.hpp"
+
+namespace {
+    // isolates kept around for reuse, more are disposed
+    const std::size_t MaxIdleIsolates = 64;
+
+    void dispose(v8::Isolate* iso)
+    {
+        IsolateCache::Destroy(iso);
+        iso->Dispose();
+    }
+}
+
+ContextSnapshot::ContextSnapshot(std::vector<intptr_t> externalReferences)
+    : _externalReferences(std::move(externalReferences))
+{
+    _externalReferences.push_back(0);
+}
+
+ContextSnapshot::~ContextSnapshot()
+{
+    for(auto& idle : _idle)
+    {
+        dispose(idle.second);
+    }
+    delete[] _blob.data;
+}
+
+std::shared_ptr<ContextSnapshot> ContextSnapshot::Create(const ContextBlueprint& blueprint)
+{
+    std::shared_ptr<ContextSnapshot> snapshot(new ContextSnapshot(blueprint.external_references));
+
+    v8::SnapshotCreator creator(snapshot->_externalReferences.data());
+    auto iso = creator.GetIsolate();
+    {
+        v8::Isolate::Scope isolate_scope(iso);
+        v8::HandleScope handle_scope(iso);
+        auto ctx = v8::Context::New(iso);
+        v8::Context::Scope context_scope(ctx);
+        if(blueprint.setup)
+            blueprint.setup(iso, ctx);
+        creator.SetDefaultContext(ctx);
+    }
+    // the blob can't be created while global handles are alive
+    IsolateCache::Destroy(iso);
+    snapshot->_blob = creator.CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+    if(!snapshot->_blob.data)
+        throw std::runtime_error("Failed to create context snapshot");
+
+    return snapshot;
+}
+
+const std::shared_ptr<ContextSnapshot>& ContextSnapshot::Default()
+{
+    // never destroyed, disposing isolates during static destruction races with V8's teardown
+    static auto snapshot = new std::shared_ptr<ContextSnapshot>(new ContextSnapshot({}));
+    return *snapshot;
+}
+
+v8::Isolate* ContextSnapshot::acquire(std::size_t heapLimitMb)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = std::find_if(_idle.rbegin(), _idle.rend(), [heapLimitMb](const std::pair<std::size_t, v8::Isolate*>& idle)
+        {
+            return idle.first == heapLimitMb;
+        });
+        if(it != _idle.rend())
+        {
+            auto iso = it->second;
+            _idle.erase(std::next(it).base());
+            return iso;
+        }
+    }
+
+    v8::Isolate::CreateParams params;
+    params.array_buffer_allocator = _allocator.get();
+    if(heapLimitMb)
+        params.constraints.set_max_old_space_size(heapLimitMb);
+    if(_blob.data)
+    {
+        params.snapshot_blob = &_blob;
+        params.external_references = _externalReferences.data();
+    }
+    return v8::Isolate::New(params);
+}
+
+void ContextSnapshot::release(v8::Isolate* iso, std::size_t heapLimitMb, bool reusable)
+{
+    assert(iso);
+    if(reusable)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_idle.size() < MaxIdleIsolates)
+        {
+            _idle.emplace_back(heapLimitMb, iso);
+            return;
+        }
+    }
+    dispose(iso);
+}
+
+std::size_t ContextSnapshot::idle() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idle.size();
+}
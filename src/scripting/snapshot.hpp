@@ -0,0 +1,57 @@
+#pragma once
+
+#include <v8.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+// What goes into a context snapshot.
+// setup runs once, when the snapshot is created, and fills in the default
+// context. Functions in there can't hold pointers to game objects, they have
+// to get their object from the context's embedder data (see bd::ThisSlot),
+// and every native callback must be listed in external_references.
+struct ContextBlueprint
+{
+    std::vector<intptr_t> external_references;
+    std::function<void(v8::Isolate*, v8::Local<v8::Context>)> setup;
+};
+
+// A startup snapshot and a pool of warm isolates deserialized from it.
+// Context::New in such an isolate deserializes the blueprint's context
+// instead of building it again, and isolates of destroyed processors are
+// recycled instead of disposed.
+class ContextSnapshot: boost::noncopyable
+{
+public:
+    // V8 must be initialized, i.e. a V8ProcessorPool was created
+    static std::shared_ptr<ContextSnapshot> Create(const ContextBlueprint& blueprint);
+
+    // V8's builtin snapshot, for processors that build their context themselves
+    static const std::shared_ptr<ContextSnapshot>& Default();
+
+    ~ContextSnapshot();
+
+    // a recycled isolate with the same heap limit if there is one, otherwise a new one
+    v8::Isolate* acquire(std::size_t heapLimitMb);
+
+    // the isolate must not be entered by any thread anymore.
+    // Isolates that are not reusable, e.g. after TerminateExecution, are disposed.
+    void release(v8::Isolate* iso, std::size_t heapLimitMb, bool reusable);
+
+    std::size_t idle() const;
+
+private:
+    ContextSnapshot(std::vector<intptr_t> externalReferences);
+
+private:
+    std::vector<intptr_t> _externalReferences;   // null terminated
+    v8::StartupData _blob{nullptr, 0};
+    std::unique_ptr<v8::ArrayBuffer::Allocator> _allocator{v8::ArrayBuffer::Allocator::NewDefaultAllocator()};
+
+    mutable std::mutex _mutex;
+    std::vector<std::pair<std::size_t, v8::Isolate*>> _idle;    // heap limit -> isolate
+};
@@ -2,9 +2,13 @@
 #include "server.hpp"
 #include "game.hpp"
 #include "objects/spaceship.hpp"
+#include "log.hpp"
+#include "world_stream.hpp"
 
 #include <unordered_map>
 #include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -24,12 +28,12 @@ public:
     virtual void on_message(const ptree& json) = 0;
     virtual void on_close(int status, const std::string& reason)
     {
-        std::cout << "Closed connection: " << reason << std::endl;
+        SC_LOG(Info, Server) << "Closed connection: " << reason;
     }
 
     virtual void on_error(const boost::system::error_code& ec)
     {
-        std::cerr << ec << std::endl;
+        SC_LOG(Warning, Server) << ec;
     }
 
     template<typename Handler>
@@ -46,11 +50,11 @@ public:
         , conn(conn)
     {
         auto hash = conn->path_match[1];
-        std::cout << "new connection with id " << hash << std::endl;
+        SC_LOG(Info, Server) << "new connection with id " << hash;
         player = Game::Current().get_player_by_hash(hash);
 
         if (!player) {
-            std::cout << "No player with id '" << hash << "'" << std::endl;
+            SC_LOG(Warning, Server) << "No player with id '" << hash << "'";
             server.send_close(conn, 1, "Unknown player hash");
         }
     }
@@ -62,7 +66,9 @@ public:
 
         post([path, code, this]() {
             player->mainShip->interact_send_code(path, code);
-            player->mainShip->interact_reboot();
+            // a full reboot if the running code can't be swapped
+            if(!player->mainShip->interact_reload())
+                player->mainShip->interact_reboot();
         });
     }
 
@@ -72,6 +78,97 @@ private:
     Player* player;
 };
 
+// Streams the shared vision of the player's fraction as binary world_stream
+// messages. The client acknowledges every message it decoded with {"ack": <sequence>},
+// so later messages only contain changes since then.
+class StreamConnection: public Connection
+{
+public:
+    StreamConnection(WsServer& server, Conn conn)
+        : server(server)
+        , conn(conn)
+    {
+        auto hash = conn->path_match[1];
+        SC_LOG(Info, Server) << "new stream connection for " << hash;
+        player = Game::Current().get_player_by_hash(hash);
+
+        if (!player) {
+            SC_LOG(Warning, Server) << "No player with id '" << hash << "'";
+            server.send_close(conn, 1, "Unknown player hash");
+            return;
+        }
+
+        post([this]() {
+            streamSub = Game::Current().on_stream().subscribe([this]() {
+                stream();
+            });
+        });
+    }
+
+    void on_message(const ptree& json) override
+    {
+        // the stream takes nothing but acks
+        auto ack = json.get_optional<std::uint32_t>("ack");
+        if (!ack)
+            return;
+        auto seq = *ack;
+        post([seq, this]() {
+            encoder.ack(seq);
+        });
+    }
+
+    void on_close(int status, const std::string& reason) override
+    {
+        Connection::on_close(status, reason);
+        post([this]() {
+            streamSub.reset();
+        });
+    }
+
+private:
+    // on the game thread
+    void stream()
+    {
+        // a slow client gets fewer updates instead of a growing send queue
+        if (sending.exchange(true))
+            return;
+
+        states.clear();
+        for (auto* obj : player->fraction().visible_objects())
+        {
+            states.push_back(world_stream::quantize(obj->id().value(), obj->position(), obj->velocity()));
+        }
+        std::sort(states.begin(), states.end(), [](const world_stream::ObjectState& a, const world_stream::ObjectState& b) {
+            return a.id < b.id;
+        });
+
+        auto& message = encoder.encode(states, [](id_value_type id) -> const std::string& {
+            return Game::Current().find_object(obj_id{id})->name();
+        });
+
+        auto out = std::make_shared<WsServer::SendStream>();
+        out->write(message.data(), message.size());
+        server.send(conn, out, [this](const boost::system::error_code& ec) {
+            sending = false;
+            if (ec)
+                on_error(ec);
+        }, BinaryFrame);
+    }
+
+private:
+    static const unsigned char BinaryFrame = 130;
+
+    WsServer& server;
+    Conn conn;
+    Player* player;
+
+    // only touched on the game thread
+    world_stream::Encoder encoder;
+    std::vector<world_stream::ObjectState> states;
+    subscription streamSub;
+    std::atomic<bool> sending{false};
+};
+
 class ServerImpl: public Server
 {
 public:
@@ -88,8 +185,9 @@ public:
         server.config.port = port;
 
         make_endpoint<UploadConnection>("^/upload/([a-z]+)$");
+        make_endpoint<StreamConnection>("^/stream/([a-z]+)$");
 
-        std::cout << "start server thread..." << std::endl;
+        SC_LOG(Info, Server) << "start server thread...";
         server_thread = std::thread([this](){
             //Start WS-server
             server.start();
@@ -115,16 +213,16 @@ private:
             try {
                 ptree json;
                 std::string jsonCode = message->string();
-                std::cout << "msg: " << jsonCode << std::endl;
+                SC_LOG(Trace, Server) << "msg: " << jsonCode;
                 std::stringstream iss(jsonCode);
                 read_json(iss, json);
                 conns[connection]->on_message(json);
             } catch (boost::property_tree::json_parser_error& e)
             {
-                std::cerr << "Failed to parse json: " << e.what() << std::endl;
+                SC_LOG(Warning, Server) << "Failed to parse json: " << e.what();
             } catch (...)
             {
-                std::cerr << "Error while message" << std::endl;
+                SC_LOG(Error, Server) << "Error while message";
             }
         };
     }
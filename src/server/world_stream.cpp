@@ -0,0 +1,326 @@
+#include "world_stream.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace world_stream {
+
+namespace {
+    void put_varint(std::string& out, std::uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(char(std::uint8_t(value) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+
+    void put_svarint(std::string& out, std::int64_t value)
+    {
+        put_varint(out, (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63));
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const std::string& message)
+            : _pos(message.data())
+            , _end(message.data() + message.size())
+        {
+        }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for(unsigned int shift = 0; shift < 64; shift += 7)
+            {
+                auto b = byte();
+                value |= std::uint64_t(b & 0x7f) << shift;
+                if(!(b & 0x80))
+                    return value;
+            }
+            throw std::runtime_error("varint too long");
+        }
+
+        std::int64_t svarint()
+        {
+            auto v = varint();
+            return std::int64_t(v >> 1) ^ -std::int64_t(v & 1);
+        }
+
+        std::uint8_t byte()
+        {
+            if(_pos == _end)
+                throw std::runtime_error("unexpected end of world stream message");
+            return std::uint8_t(*_pos++);
+        }
+
+        std::string bytes(std::size_t count)
+        {
+            if(std::size_t(_end - _pos) < count)
+                throw std::runtime_error("unexpected end of world stream message");
+            std::string result(_pos, count);
+            _pos += count;
+            return result;
+        }
+
+        bool done() const
+        {
+            return _pos == _end;
+        }
+
+    private:
+        const char* _pos;
+        const char* _end;
+    };
+
+    std::int32_t quantize(float value, float quantum)
+    {
+        return std::int32_t(std::lround(value / quantum));
+    }
+
+    const std::string NoName{};
+}
+
+
+bool ObjectState::operator ==(const ObjectState& other) const
+{
+    return id == other.id && x == other.x && y == other.y && vx == other.vx && vy == other.vy;
+}
+
+ObjectState quantize(id_value_type id, const vec2& position, const vec2& velocity)
+{
+    return ObjectState{
+        id,
+        quantize(position.x, PositionQuantum),
+        quantize(position.y, PositionQuantum),
+        quantize(velocity.x, VelocityQuantum),
+        quantize(velocity.y, VelocityQuantum)
+    };
+}
+
+vec2 position_of(const ObjectState& state)
+{
+    return vec2(state.x * PositionQuantum, state.y * PositionQuantum);
+}
+
+vec2 velocity_of(const ObjectState& state)
+{
+    return vec2(state.vx * VelocityQuantum, state.vy * VelocityQuantum);
+}
+
+
+const std::string& Encoder::encode(const std::vector<ObjectState>& states, const NameLookup& nameOf)
+{
+    const auto sequence = ++_sequence;
+
+    // the client only keeps the last HistorySize snapshots
+    if(_baseline.sequence && sequence - _baseline.sequence >= HistorySize)
+    {
+        _baseline.sequence = 0;
+        _baseline.states.clear();
+    }
+
+    _entries.clear();
+    _removed.clear();
+    std::size_t entryCount = 0;
+    std::size_t removedCount = 0;
+    id_value_type lastEntry = 0;
+    id_value_type lastRemoved = 0;
+
+    auto& base = _baseline.states;
+    auto b = base.begin();
+    for(auto& state : states)
+    {
+        assert(&state == &states.front() || (&state - 1)->id < state.id);
+
+        for(; b != base.end() && b->id < state.id; ++b)
+        {
+            put_varint(_removed, b->id - lastRemoved);
+            lastRemoved = b->id;
+            ++removedCount;
+        }
+
+        std::uint8_t flags;
+        ObjectState from{state.id, 0, 0, 0, 0};
+        if(b != base.end() && b->id == state.id)
+        {
+            from = *b++;
+            flags = (state.x != from.x? ChangedX : 0)
+                  | (state.y != from.y? ChangedY : 0)
+                  | (state.vx != from.vx? ChangedVX : 0)
+                  | (state.vy != from.vy? ChangedVY : 0);
+            if(!flags)
+                continue;
+        } else {
+            flags = New | ChangedX | ChangedY | ChangedVX | ChangedVY;
+        }
+
+        put_varint(_entries, state.id - lastEntry);
+        lastEntry = state.id;
+        _entries.push_back(char(flags));
+        if(flags & New)
+        {
+            auto& name = nameOf(state.id);
+            put_varint(_entries, name.size());
+            _entries.append(name);
+        }
+        if(flags & ChangedX)
+            put_svarint(_entries, std::int64_t(state.x) - from.x);
+        if(flags & ChangedY)
+            put_svarint(_entries, std::int64_t(state.y) - from.y);
+        if(flags & ChangedVX)
+            put_svarint(_entries, std::int64_t(state.vx) - from.vx);
+        if(flags & ChangedVY)
+            put_svarint(_entries, std::int64_t(state.vy) - from.vy);
+        ++entryCount;
+    }
+    for(; b != base.end(); ++b)
+    {
+        put_varint(_removed, b->id - lastRemoved);
+        lastRemoved = b->id;
+        ++removedCount;
+    }
+
+    _message.clear();
+    put_varint(_message, sequence);
+    put_varint(_message, _baseline.sequence);
+    put_varint(_message, removedCount);
+    _message.append(_removed);
+    put_varint(_message, entryCount);
+    _message.append(_entries);
+
+    auto& sent = _sent[sequence % HistorySize];
+    sent.sequence = sequence;
+    sent.states.assign(states.begin(), states.end());
+    return _message;
+}
+
+void Encoder::ack(std::uint32_t sequence)
+{
+    // ignore acks that are reordered, forged or too old to be remembered
+    if(sequence <= _baseline.sequence || sequence > _sequence)
+        return;
+    auto& sent = _sent[sequence % HistorySize];
+    if(sent.sequence != sequence)
+        return;
+
+    _baseline.sequence = sequence;
+    _baseline.states.assign(sent.states.begin(), sent.states.end());
+}
+
+std::uint32_t Encoder::sequence() const
+{
+    return _sequence;
+}
+
+std::uint32_t Encoder::baseline() const
+{
+    return _baseline.sequence;
+}
+
+
+std::uint32_t Decoder::decode(const std::string& message)
+{
+    Reader in(message);
+    auto sequence = std::uint32_t(in.varint());
+    auto baseline = std::uint32_t(in.varint());
+    if(!sequence || baseline >= sequence)
+        throw std::runtime_error("invalid world stream sequence");
+
+    static const std::vector<ObjectState> Empty;
+    const std::vector<ObjectState>* base = &Empty;
+    if(baseline)
+    {
+        auto& snapshot = _received[baseline % HistorySize];
+        if(snapshot.sequence != baseline)
+            throw std::runtime_error("unknown world stream baseline " + std::to_string(baseline));
+        base = &snapshot.states;
+    }
+
+    auto& target = _received[sequence % HistorySize];
+    // may be the slot of the baseline, which is read while writing
+    std::vector<ObjectState> states;
+    states.reserve(base->size());
+
+    auto removedCount = in.varint();
+    if(removedCount > message.size())
+        throw std::runtime_error("invalid world stream removal count");
+    std::vector<id_value_type> removed(removedCount);
+    id_value_type id = 0;
+    for(auto& r : removed)
+    {
+        id += id_value_type(in.varint());
+        r = id;
+    }
+
+    auto b = base->begin();
+    auto r = removed.begin();
+    // copies unchanged objects of the baseline that come before the given id
+    auto take_base = [&](id_value_type until, bool all)
+    {
+        for(; b != base->end() && (all || b->id < until); ++b)
+        {
+            while(r != removed.end() && *r < b->id)
+                ++r;
+            if(r != removed.end() && *r == b->id)
+                continue;
+            states.push_back(*b);
+        }
+    };
+
+    auto entryCount = in.varint();
+    id = 0;
+    for(std::uint64_t i = 0; i < entryCount; ++i)
+    {
+        id += id_value_type(in.varint());
+        take_base(id, false);
+
+        auto flags = in.byte();
+        ObjectState state{id, 0, 0, 0, 0};
+        if(flags & New)
+        {
+            _names[id] = in.bytes(std::size_t(in.varint()));
+            if(b != base->end() && b->id == id)
+                ++b;
+        } else {
+            if(b == base->end() || b->id != id)
+                throw std::runtime_error("world stream delta for unknown object");
+            state = *b++;
+        }
+        if(flags & ChangedX)
+            state.x += std::int32_t(in.svarint());
+        if(flags & ChangedY)
+            state.y += std::int32_t(in.svarint());
+        if(flags & ChangedVX)
+            state.vx += std::int32_t(in.svarint());
+        if(flags & ChangedVY)
+            state.vy += std::int32_t(in.svarint());
+        states.push_back(state);
+    }
+    take_base(0, true);
+
+    if(!in.done())
+        throw std::runtime_error("trailing bytes in world stream message");
+
+    target.sequence = sequence;
+    target.states = std::move(states);
+    _last = sequence;
+    return sequence;
+}
+
+const std::vector<ObjectState>& Decoder::states() const
+{
+    static const std::vector<ObjectState> Empty;
+    return _last? _received[_last % HistorySize].states : Empty;
+}
+
+const std::string& Decoder::name(id_value_type id) const
+{
+    auto it = _names.find(id);
+    return it == _names.end()? NoName : it->second;
+}
+
+}
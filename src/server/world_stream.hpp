@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "defs.hpp"
+#include "id.hpp"
+
+// Binary world state stream.
+//
+// Every message is a snapshot of the objects a client can see, encoded as a
+// delta against an older snapshot the client has acknowledged (the baseline),
+// or against nothing if there is none. Positions and velocities are quantized
+// to fixed point, so unchanged objects cost nothing and moving ones a few bytes.
+//
+// Message layout (varint = unsigned LEB128, svarint = zigzag encoded varint):
+//   varint  sequence            starts at 1
+//   varint  baseline            sequence of the baseline, 0 for none
+//   varint  removed count, followed by the removed ids as varint gaps
+//   varint  entry count, followed by the entries:
+//       varint  id gap          ids are ascending, gaps start from 0
+//       u8      flags           EntryFlags
+//       [varint length, bytes]  name, only if New
+//       svarint x, y, vx, vy    difference to the baseline, only the flagged ones
+// Objects of the baseline without entry are unchanged.
+namespace world_stream {
+
+    struct ObjectState
+    {
+        id_value_type id;
+        std::int32_t x, y;      // in PositionQuantum
+        std::int32_t vx, vy;    // in VelocityQuantum
+
+        bool operator ==(const ObjectState& other) const;
+    };
+
+    enum EntryFlags : std::uint8_t
+    {
+        ChangedX = 1 << 0,
+        ChangedY = 1 << 1,
+        ChangedVX = 1 << 2,
+        ChangedVY = 1 << 3,
+        New = 1 << 4
+    };
+
+    const float PositionQuantum = 1.0f / 16.0f;    // in meter
+    const float VelocityQuantum = 1.0f / 16.0f;    // in meter per second
+
+    // number of snapshots a client must keep to resolve baselines
+    const std::uint32_t HistorySize = 32;
+
+    ObjectState quantize(id_value_type id, const vec2& position, const vec2& velocity);
+    vec2 position_of(const ObjectState& state);
+    vec2 velocity_of(const ObjectState& state);
+
+    // Server side of one stream. Not thread safe.
+    class Encoder: boost::noncopyable
+    {
+    public:
+        using NameLookup = std::function<const std::string&(id_value_type)>;
+
+        // encodes the next snapshot from states sorted by id.
+        // The returned message is valid until the next call.
+        const std::string& encode(const std::vector<ObjectState>& states, const NameLookup& nameOf);
+
+        // the client received the snapshot with the given sequence
+        void ack(std::uint32_t sequence);
+
+        std::uint32_t sequence() const;         // of the last encoded snapshot
+        std::uint32_t baseline() const;         // 0 if there is none
+
+    private:
+        struct Snapshot
+        {
+            std::uint32_t sequence = 0;
+            std::vector<ObjectState> states;
+        };
+
+        std::uint32_t _sequence = 0;
+        std::array<Snapshot, HistorySize> _sent{};  // indexed by sequence % HistorySize
+        Snapshot _baseline{};
+        std::string _message{};
+        std::string _entries{};
+        std::string _removed{};
+    };
+
+    // Client side of one stream, the reference for other client implementations.
+    class Decoder: boost::noncopyable
+    {
+    public:
+        // applies a message and returns its sequence, which should be acknowledged.
+        // Throws std::runtime_error for malformed messages or unknown baselines.
+        std::uint32_t decode(const std::string& message);
+
+        // objects of the last decoded snapshot, sorted by id
+        const std::vector<ObjectState>& states() const;
+        const std::string& name(id_value_type id) const;
+
+    private:
+        struct Snapshot
+        {
+            std::uint32_t sequence = 0;
+            std::vector<ObjectState> states;
+        };
+
+        std::array<Snapshot, HistorySize> _received{};
+        std::uint32_t _last = 0;
+        // names are only sent with the first appearance of an object
+        std::unordered_map<id_value_type, std::string> _names{};
+    };
+}
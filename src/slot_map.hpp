@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <boost/noncopyable.hpp>
+#include "id.hpp"
+
+// Generational slot map.
+// Keys encode a slot index and the generation of that slot, so lookups are a
+// plain array access and keys of erased values are detected as stale.
+// Values are kept packed in a dense array, iteration runs over that array
+// (in no particular order after erasing).
+// A slot whose generation is used up is retired instead of reused, so a key
+// never becomes valid again. Reserving throws once all slots are used.
+template<typename T>
+class SlotMap: boost::noncopyable
+{
+public:
+    using key_type = id_value_type;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    static constexpr unsigned int IndexBits = 20;
+    static constexpr key_type IndexMask = (key_type(1) << IndexBits) - 1;
+    static constexpr key_type GenerationMask = key_type(-1) >> IndexBits;
+    static constexpr std::size_t MaxSize = std::size_t(IndexMask) + 1;
+
+public:
+    // allocates a key without a value, the value is given later with assign,
+    // throws std::length_error if there are no slots left
+    key_type reserve()
+    {
+        std::uint32_t index;
+        if(_freeHead != NoSlot)
+        {
+            index = _freeHead;
+            _freeHead = _slots[index].nextFree;
+        } else {
+            if(_slots.size() >= MaxSize)
+                throw std::length_error("slot map is full");
+            index = std::uint32_t(_slots.size());
+            _slots.emplace_back();
+        }
+
+        auto& slot = _slots[index];
+        slot.dense = Reserved;
+        return make_key(index, slot.generation);
+    }
+
+    void assign(key_type key, T value)
+    {
+        auto& slot = _slots[index_of(key)];
+        assert(slot.generation == generation_of(key));
+        assert(slot.dense == Reserved);
+
+        slot.dense = std::uint32_t(_values.size());
+        _values.push_back(std::move(value));
+        _denseToSlot.push_back(index_of(key));
+    }
+
+    key_type insert(T value)
+    {
+        auto key = reserve();
+        assign(key, std::move(value));
+        return key;
+    }
+
+    // returns false if the key is stale
+    bool erase(key_type key)
+    {
+        auto index = index_of(key);
+        if(index >= _slots.size())
+            return false;
+
+        auto& slot = _slots[index];
+        if(slot.generation != generation_of(key) || slot.dense == Free)
+            return false;
+
+        if(slot.dense != Reserved)
+        {
+            // move the last value into the gap
+            auto dense = slot.dense;
+            auto lastSlot = _denseToSlot.back();
+            _values[dense] = std::move(_values.back());
+            _denseToSlot[dense] = lastSlot;
+            _slots[lastSlot].dense = dense;
+            _values.pop_back();
+            _denseToSlot.pop_back();
+        }
+
+        slot.dense = Free;
+        if(slot.generation == GenerationMask)
+        {
+            // the next generation would wrap to keys handed out before
+            return true;
+        }
+        ++slot.generation;
+        slot.nextFree = _freeHead;
+        _freeHead = index;
+        return true;
+    }
+
+    T* find(key_type key)
+    {
+        auto dense = dense_of(key);
+        return dense == NoSlot? nullptr : &_values[dense];
+    }
+
+    const T* find(key_type key) const
+    {
+        auto dense = dense_of(key);
+        return dense == NoSlot? nullptr : &_values[dense];
+    }
+
+    bool contains(key_type key) const
+    {
+        return dense_of(key) != NoSlot;
+    }
+
+    std::size_t size() const
+    {
+        return _values.size();
+    }
+
+    bool empty() const
+    {
+        return _values.empty();
+    }
+
+    // key of the value at a position of the dense array
+    key_type key_at(std::size_t dense) const
+    {
+        auto index = _denseToSlot[dense];
+        return make_key(index, _slots[index].generation);
+    }
+
+    iterator begin() { return _values.begin(); }
+    iterator end() { return _values.end(); }
+    const_iterator begin() const { return _values.begin(); }
+    const_iterator end() const { return _values.end(); }
+
+private:
+    static constexpr std::uint32_t NoSlot = std::uint32_t(-1);
+    static constexpr std::uint32_t Free = NoSlot;
+    static constexpr std::uint32_t Reserved = NoSlot - 1;
+
+    struct Slot
+    {
+        key_type generation = 0;
+        std::uint32_t dense = Free;     // position in _values, Free or Reserved
+        std::uint32_t nextFree = NoSlot;
+    };
+
+    static key_type make_key(std::uint32_t index, key_type generation)
+    {
+        return (generation << IndexBits) | key_type(index);
+    }
+
+    static std::uint32_t index_of(key_type key)
+    {
+        return std::uint32_t(key & IndexMask);
+    }
+
+    static key_type generation_of(key_type key)
+    {
+        return key >> IndexBits;
+    }
+
+    std::uint32_t dense_of(key_type key) const
+    {
+        auto index = index_of(key);
+        if(index >= _slots.size())
+            return NoSlot;
+
+        auto& slot = _slots[index];
+        if(slot.generation != generation_of(key) || slot.dense >= _values.size())
+            return NoSlot;
+        return slot.dense;
+    }
+
+private:
+    std::vector<Slot> _slots{};
+    std::vector<T> _values{};
+    std::vector<std::uint32_t> _denseToSlot{};
+    std::uint32_t _freeHead = NoSlot;
+};
@@ -0,0 +1,76 @@
+#include "spatial_hash.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include "game_object.hpp"
+
+SpatialHash::SpatialHash(float cellSize)
+    : _cellSize(cellSize)
+{
+    assert(cellSize > 0.0f);
+}
+
+float SpatialHash::cell_size() const
+{
+    return _cellSize;
+}
+
+void SpatialHash::rebuild(float cellSize)
+{
+    assert(cellSize > 0.0f);
+
+    std::vector<GameObject*> objs;
+    for(auto& cell : _cells)
+    {
+        objs.insert(objs.end(), cell.second.begin(), cell.second.end());
+    }
+
+    _cells.clear();
+    _cellSize = cellSize;
+
+    for(GameObject* obj : objs)
+    {
+        insert(obj);
+    }
+}
+
+void SpatialHash::insert(GameObject* obj)
+{
+    obj->_cell = key_of(obj->position());
+    _cells[obj->_cell].push_back(obj);
+}
+
+void SpatialHash::move(GameObject* obj)
+{
+    auto key = key_of(obj->position());
+    if(key == obj->_cell)
+        return;
+
+    auto it = _cells.find(obj->_cell);
+    assert(it != _cells.end());
+    auto& bucket = it->second;
+    auto pos = std::find(bucket.begin(), bucket.end(), obj);
+    assert(pos != bucket.end());
+    *pos = bucket.back();
+    bucket.pop_back();
+    if(bucket.empty())
+        _cells.erase(it);
+
+    obj->_cell = key;
+    _cells[key].push_back(obj);
+}
+
+std::int32_t SpatialHash::cell_coord(float v) const
+{
+    return static_cast<std::int32_t>(std::floor(v / _cellSize));
+}
+
+SpatialHash::cell_key SpatialHash::key_of(const vec2& pos) const
+{
+    return make_key(cell_coord(pos.x), cell_coord(pos.y));
+}
+
+SpatialHash::cell_key SpatialHash::make_key(std::int32_t x, std::int32_t y)
+{
+    return (cell_key(std::uint32_t(x)) << 32) | cell_key(std::uint32_t(y));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <unordered_map>
+#include <boost/noncopyable.hpp>
+#include "defs.hpp"
+
+class GameObject;
+
+// Uniform grid bucketing objects by their position.
+// With a cell size >= the biggest sight, everything an object can see
+// lies in its own or one of the eight surrounding cells.
+class SpatialHash: boost::noncopyable
+{
+public:
+    using cell_key = std::uint64_t;
+
+    explicit SpatialHash(float cellSize);
+
+    float cell_size() const;
+    void rebuild(float cellSize);
+
+    void insert(GameObject* obj);
+    void move(GameObject* obj);
+
+    template<typename Func>
+    void query(const vec2& pos, Func&& func) const
+    {
+        auto cx = cell_coord(pos.x);
+        auto cy = cell_coord(pos.y);
+
+        for(std::int32_t y = cy - 1; y <= cy + 1; ++y)
+        {
+            for(std::int32_t x = cx - 1; x <= cx + 1; ++x)
+            {
+                auto it = _cells.find(make_key(x, y));
+                if(it == _cells.end())
+                    continue;
+
+                for(GameObject* obj : it->second)
+                {
+                    func(obj);
+                }
+            }
+        }
+    }
+
+private:
+    std::int32_t cell_coord(float v) const;
+    cell_key key_of(const vec2& pos) const;
+    static cell_key make_key(std::int32_t x, std::int32_t y);
+
+private:
+    float _cellSize;
+    std::unordered_map<cell_key, std::vector<GameObject*>> _cells{};
+};
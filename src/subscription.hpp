@@ -1,18 +1,20 @@
 #pragma once
 
 #include <forward_list>
+#include <functional>
 #include <memory>
 
 namespace detail {
 
     struct subscription_base
     {
-        virtual ~subscription_base();
+        virtual ~subscription_base() = default;
     };
 
 }
 
-using subscription = std::shared_ptr<subscription_base>;
+// keeps a subscription alive, drop it to unsubscribe
+using subscription = std::shared_ptr<detail::subscription_base>;
 
 template<typename... Args>
 class subscriptable
@@ -20,9 +22,9 @@ class subscriptable
 public:
     using subscription_func = std::function<void(const Args&...)>;
 private:
-    struct subscription_inst : subscription_base
+    struct subscription_inst : detail::subscription_base
     {
-        subscription_inst(subsription_func&& func)
+        subscription_inst(subscription_func&& func)
             : func(std::move(func))
         {
         }
@@ -32,20 +34,27 @@ private:
 public:    
     subscription subscribe(subscription_func func)
     {
-        return std::make_shared<subscription_inst>(std::move(func));
+        auto inst = std::make_shared<subscription_inst>(std::move(func));
+        _subscriptions.push_front(inst);
+        return inst;
+    }
+
+    bool has_subscribers() const
+    {
+        return !_subscriptions.empty();
     }
 
     void notify(const Args&... args)
     {
         auto last_it = _subscriptions.before_begin();
-        auto it = _subscription.begin();
+        auto it = _subscriptions.begin();
 
-        while(it != _subscription.end())
+        while(it != _subscriptions.end())
         {
             if(it->unique())
             {
-                ++it;
-                _subscription.erase(last_it);
+                // nobody holds the subscription anymore
+                it = _subscriptions.erase_after(last_it);
             } else {
                 (*it)->func(args...);
                 last_it = it;
@@ -56,4 +65,4 @@ public:
 
 private:
     std::forward_list<std::shared_ptr<subscription_inst>> _subscriptions{};
-};
\ No newline at end of file
+};
@@ -0,0 +1,176 @@
+#include "tick_scheduler.hpp"
+
+#include <cassert>
+#include <thread>
+
+namespace {
+    // weight of a new sample in the moving averages
+    const int AverageWindow = 32;
+
+    double to_ms(TickScheduler::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+}
+
+const TickScheduler::PhaseStats& TickScheduler::Metrics::phase(Phase p) const
+{
+    return phases[std::size_t(p)];
+}
+
+
+TickScheduler::PhaseTimer::PhaseTimer(TickScheduler& scheduler, Phase phase)
+    : _scheduler(&scheduler)
+    , _phase(phase)
+    , _start(clock::now())
+{
+}
+
+TickScheduler::PhaseTimer::PhaseTimer(PhaseTimer&& other)
+    : _scheduler(other._scheduler)
+    , _phase(other._phase)
+    , _start(other._start)
+{
+    other._scheduler = nullptr;
+}
+
+TickScheduler::PhaseTimer::~PhaseTimer()
+{
+    if(_scheduler)
+        _scheduler->record(_phase, clock::now() - _start);
+}
+
+
+TickScheduler::TickScheduler(unsigned int tickRate, unsigned int maxCatchUp)
+    : _tickRate(tickRate)
+    , _maxCatchUp(maxCatchUp)
+    , _tickDuration(std::chrono::duration_cast<duration>(std::chrono::seconds(1)) / tickRate)
+    , _last(clock::now())
+{
+    assert(tickRate > 0);
+    assert(maxCatchUp > 0);
+}
+
+unsigned int TickScheduler::tick_rate() const
+{
+    return _tickRate;
+}
+
+TickScheduler::duration TickScheduler::tick_duration() const
+{
+    return _tickDuration;
+}
+
+float TickScheduler::dt() const
+{
+    return 1.0f / _tickRate;
+}
+
+unsigned int TickScheduler::wait()
+{
+    auto now = clock::now();
+    _accumulator += now - _last;
+    _last = now;
+
+    if(_accumulator < _tickDuration)
+    {
+        std::this_thread::sleep_until(now + (_tickDuration - _accumulator));
+        now = clock::now();
+        _accumulator += now - _last;
+        _last = now;
+    }
+
+    auto due = _accumulator / _tickDuration;
+    if(due > _maxCatchUp)
+    {
+        // we are too far behind, let the simulation run slower instead of spiraling
+        _metrics.dropped_ticks += due - _maxCatchUp;
+        _accumulator = _accumulator % _tickDuration;
+        return _maxCatchUp;
+    }
+
+    _accumulator -= due * _tickDuration;
+    return unsigned(due);
+}
+
+TickScheduler::PhaseTimer TickScheduler::measure(Phase phase)
+{
+    return PhaseTimer(*this, phase);
+}
+
+void TickScheduler::begin_tick()
+{
+    _tickStart = clock::now();
+}
+
+void TickScheduler::end_tick()
+{
+    auto d = clock::now() - _tickStart;
+    accumulate(_metrics.tick_average, _metrics.tick_max, _metrics.tick_last, d);
+    ++_metrics.ticks;
+    if(d > _tickDuration)
+        ++_metrics.overruns;
+}
+
+const TickScheduler::Metrics& TickScheduler::metrics() const
+{
+    return _metrics;
+}
+
+void TickScheduler::reset_max()
+{
+    _metrics.tick_max = duration{};
+    for(auto& phase : _metrics.phases)
+    {
+        phase.max = duration{};
+    }
+}
+
+void TickScheduler::record(Phase phase, duration d)
+{
+    assert(phase < Phase::Count);
+    auto& stats = _metrics.phases[std::size_t(phase)];
+    accumulate(stats.average, stats.max, stats.last, d);
+}
+
+void TickScheduler::accumulate(duration& average, duration& max, duration& last, duration d)
+{
+    last = d;
+    average += (d - average) / AverageWindow;
+    if(d > max)
+        max = d;
+}
+
+
+const char* to_string(TickScheduler::Phase phase)
+{
+    switch(phase)
+    {
+    case TickScheduler::Phase::Network:
+        return "network";
+    case TickScheduler::Phase::Physics:
+        return "physics";
+    case TickScheduler::Phase::Scripting:
+        return "scripting";
+    case TickScheduler::Phase::Streaming:
+        return "streaming";
+    default:
+        return "unknown";
+    }
+}
+
+std::ostream& operator <<(std::ostream& s, const TickScheduler::Metrics& metrics)
+{
+    s << "ticks: " << metrics.ticks
+      << ", overruns: " << metrics.overruns
+      << ", dropped: " << metrics.dropped_ticks
+      << ", tick avg/max: " << to_ms(metrics.tick_average) << "/" << to_ms(metrics.tick_max) << "ms";
+
+    for(std::size_t i = 0; i < metrics.phases.size(); ++i)
+    {
+        auto& phase = metrics.phases[i];
+        s << ", " << to_string(TickScheduler::Phase(i))
+          << " avg/max: " << to_ms(phase.average) << "/" << to_ms(phase.max) << "ms";
+    }
+    return s;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <boost/noncopyable.hpp>
+
+// Paces the game loop to a fixed simulation rate.
+// Time that could not be simulated (because ticks took too long) is caught up
+// with additional ticks, but never more than max_catch_up per wait.
+class TickScheduler: boost::noncopyable
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using duration = clock::duration;
+
+    enum class Phase
+    {
+        Network,
+        Physics,
+        Scripting,
+        Streaming,
+        Count
+    };
+
+    struct PhaseStats
+    {
+        duration last{};
+        duration average{};     // exponential moving average
+        duration max{};
+    };
+
+    struct Metrics
+    {
+        std::array<PhaseStats, std::size_t(Phase::Count)> phases{};
+        duration tick_last{};
+        duration tick_average{};
+        duration tick_max{};
+        unsigned long long ticks = 0;
+        unsigned long long overruns = 0;       // ticks that took longer than their budget
+        unsigned long long dropped_ticks = 0;  // ticks skipped because the catch up limit was hit
+
+        const PhaseStats& phase(Phase p) const;
+    };
+
+    class PhaseTimer: boost::noncopyable
+    {
+    public:
+        PhaseTimer(TickScheduler& scheduler, Phase phase);
+        PhaseTimer(PhaseTimer&& other);
+        ~PhaseTimer();
+
+    private:
+        TickScheduler* _scheduler;
+        Phase _phase;
+        clock::time_point _start;
+    };
+
+public:
+    TickScheduler(unsigned int tickRate, unsigned int maxCatchUp);
+
+    unsigned int tick_rate() const;
+    duration tick_duration() const;
+    float dt() const;               // in seconds
+
+    // sleeps until at least one tick is due and returns the number of ticks to simulate
+    unsigned int wait();
+
+    PhaseTimer measure(Phase phase);
+    void begin_tick();
+    void end_tick();
+
+    const Metrics& metrics() const;
+    void reset_max();
+
+private:
+    void record(Phase phase, duration d);
+    static void accumulate(duration& average, duration& max, duration& last, duration d);
+
+private:
+    const unsigned int _tickRate;
+    const unsigned int _maxCatchUp;
+    const duration _tickDuration;
+    clock::time_point _last;
+    clock::time_point _tickStart;
+    duration _accumulator{};
+    Metrics _metrics{};
+};
+
+const char* to_string(TickScheduler::Phase phase);
+std::ostream& operator <<(std::ostream& s, const TickScheduler::Metrics& metrics);
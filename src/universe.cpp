@@ -1,82 +1,297 @@
 #include "universe.hpp"
 
-#include <iostream>
+#include <cassert>
+#include <tuple>
+#include <algorithm>
+#include "log.hpp"
 
-void Universe::add_object(std::shared_ptr<GameObject> obj)
+namespace {
+    const float DefaultCellSize = 64.0f;
+
+    // work per parallel task, motion chunks stay a multiple of the simd width
+    const std::size_t MotionChunkSize = 1024;
+    const std::size_t SightChunkSize = 128;
+
+    // calls func(ref, true) for every entry only in current and
+    // func(ref, false) for every entry only in previous, in ascending order
+    template<typename Func>
+    void diff_sorted(const std::vector<std::uint32_t>& previous, const std::vector<std::uint32_t>& current, Func&& func)
+    {
+        auto p = previous.begin();
+        auto c = current.begin();
+        while(p != previous.end() || c != current.end())
+        {
+            if(c == current.end() || (p != previous.end() && *p < *c))
+            {
+                func(*p++, false);
+            }else if(p == previous.end() || *c < *p)
+            {
+                func(*c++, true);
+            }else{
+                ++p;
+                ++c;
+            }
+        }
+    }
+}
+
+Universe::Universe(unsigned int threads)
+    : _dynGrid(DefaultCellSize)
+    , _staticGrid(DefaultCellSize)
+    , _workers(threads)
 {
-    if(obj->active())
+}
+
+void Universe::add_object(const obj_ptr& obj)
+{
+    assert(!obj->_universe);
+
+    auto sight = obj->sight();
+    if(sight > _maxSight)
     {
-        _dynObjs.push_back(std::move(obj));
+        _maxSight = sight;
+        auto cellSize = std::max(DefaultCellSize, _maxSight);
+        if(cellSize != _dynGrid.cell_size())
+        {
+            _dynGrid.rebuild(cellSize);
+            _staticGrid.rebuild(cellSize);
+        }
+    }
+
+    obj->_universe = this;
+    obj->_dynamic = obj->active();
+    _motion.set_dynamic(obj->_motionHandle, obj->_dynamic);
+    _motion.set_limits(obj->_motionHandle, obj->acceleration(), obj->max_speed());
+    if(obj->_dynamic)
+    {
+        obj->_universeIndex = _dynObjs.size();
+        _dynGrid.insert(obj.get());
+        _dynObjs.push_back(obj.get());
     }else{
-        _staticObjs.push_back(std::move(obj));
+        obj->_universeIndex = _staticObjs.size();
+        _staticGrid.insert(obj.get());
+        _staticObjs.push_back(obj.get());
+    }
+
+    if(auto fraction = obj->fraction())
+    {
+        auto it = std::find_if(_fractionVisions.begin(), _fractionVisions.end(), [fraction](const FractionVision& v)
+        {
+            return v.fraction == fraction;
+        });
+        if(it == _fractionVisions.end())
+        {
+            it = _fractionVisions.insert(it, FractionVision{fraction, {}, {}, {}, {}});
+        }
+        it->members.push_back(sight_ref(obj.get()));
     }
 }
 
 void Universe::update(float dt)
 {
-    for(auto& obj : _dynObjs)
+    // targets may follow other objects
+    for(auto obj : _dynObjs)
     {
-        obj->_update(dt);
+        if(obj->_target)
+            _motion.set_target(obj->_motionHandle, obj->_target->position());
     }
 
-    // check sights
-    for(auto it = _dynObjs.begin(); it != _dynObjs.end(); ++it)
+    // movement, every slot is independent
+    _workers.parallel_for(_motion.size(), MotionChunkSize, [this, dt](std::size_t, std::size_t begin, std::size_t end)
     {
-        auto& obj = *it;
-        auto sight = obj->sight();
+        _motion.integrate(dt, begin, end);
+    });
 
-        if (sight > 0.0f)
+    for(auto obj : _dynObjs)
+    {
+        _dynGrid.move(obj);
+        if (obj->velocity() != vec2())
         {
-            // check with static object
-            for(auto& sobj : _staticObjs)
-            {
-                auto dist = glm::distance(sobj->position(), obj->position());
-                _check_sight(obj, sobj, dist < sight);
-            }
+            SC_LOG(Trace, Universe) << obj->name() << " at " << obj->position();
         }
+    }
 
-        // check with other dynamic objects
-        for(auto it2 = std::next(it); it2 != _dynObjs.end(); ++it2)
+    // Every object diffs what it sees now against its own sight set from
+    // the last tick, so this can run in any order. The resulting events are
+    // fired in the order a sequential scan over all pairs would produce.
+    _sightScratch.resize(WorkerPool::chunk_count(_dynObjs.size(), SightChunkSize));
+    _workers.parallel_for(_dynObjs.size(), SightChunkSize, [this](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+        auto& scratch = _sightScratch[chunk];
+        scratch.events.clear();
+        for(std::size_t i = begin; i < end; ++i)
         {
-            auto& obj2 = *it2;
-            auto sight2 = obj2->sight();
-            auto dist = glm::distance(obj->position(), obj2->position());
-            _check_sight(obj, obj2, dist < sight);
+            _detect_sight(i, scratch);
+        }
+    });
 
-            if(sight2 > 0.0f) {
-                _check_sight(obj2, obj, dist < sight2);
-            }
+    _sightEvents.clear();
+    for(auto& scratch : _sightScratch)
+    {
+        _sightEvents.insert(_sightEvents.end(), scratch.events.begin(), scratch.events.end());
+    }
+    std::sort(_sightEvents.begin(), _sightEvents.end());
+
+    for(const auto& e : _sightEvents)
+    {
+        switch(e.pass)
+        {
+        case SightEvent::Static:
+            _fire_sight(_dynObjs[e.first], _staticObjs[e.second], e.insight);
+            break;
+        case SightEvent::Forward:
+            _fire_sight(_dynObjs[e.first], _dynObjs[e.second], e.insight);
+            break;
+        case SightEvent::Backward:
+            _fire_sight(_dynObjs[e.second], _dynObjs[e.first], e.insight);
+            break;
         }
     }
+
+    _update_fraction_vision();
+}
+
+MotionStore& Universe::motion()
+{
+    return _motion;
+}
+
+void Universe::_on_moved(GameObject* obj)
+{
+    if(obj->_dynamic)
+    {
+        _dynGrid.move(obj);
+    }else{
+        _staticGrid.move(obj);
+    }
 }
 
+void Universe::_detect_sight(std::size_t idx, SightScratch& scratch) const
+{
+    auto obj = _dynObjs[idx];
+    auto sight = obj->sight();
+    auto& current = scratch.current;
+    current.clear();
+
+    // everything in sight is within the neighbouring cells
+    if(sight > 0.0f)
+    {
+        auto pos = obj->position();
+        _staticGrid.query(pos, [&current, &pos, sight](GameObject* sobj)
+        {
+            if(glm::distance(sobj->position(), pos) < sight)
+                current.push_back(sight_ref(sobj));
+        });
+        _dynGrid.query(pos, [&current, &pos, sight, obj](GameObject* other)
+        {
+            if(other != obj && glm::distance(pos, other->position()) < sight)
+                current.push_back(sight_ref(other));
+        });
+        std::sort(current.begin(), current.end());
+    }
 
-void Universe::_check_sight(const obj_ptr& subj, const obj_ptr& to, bool insight)
+    auto emit = [&scratch, idx](std::uint32_t ref, bool insight)
+    {
+        auto other = std::size_t(ref & ~DynamicRef);
+        if(!(ref & DynamicRef))
+        {
+            scratch.events.push_back(SightEvent{idx, SightEvent::Static, other, insight});
+        }else if(idx < other)
+        {
+            scratch.events.push_back(SightEvent{idx, SightEvent::Forward, other, insight});
+        }else{
+            scratch.events.push_back(SightEvent{other, SightEvent::Backward, idx, insight});
+        }
+    };
+
+    // diff against what was in sight last tick
+    auto& previous = obj->_inSight;
+    diff_sorted(previous, current, emit);
+
+    // only this task touches the sight set of obj
+    previous.swap(current);
+}
+
+const std::uint32_t Universe::DynamicRef;
+
+std::uint32_t Universe::sight_ref(const GameObject* obj)
 {
-    auto& sightSet = subj->_objInSight;
-    auto id = to->id();
-    auto it = sightSet.find(id);
+    assert(obj->_universeIndex < DynamicRef);
+    return std::uint32_t(obj->_universeIndex) | (obj->_dynamic? DynamicRef : 0);
+}
 
-    if(it == sightSet.end())
+GameObject* Universe::from_sight_ref(std::uint32_t ref) const
+{
+    auto idx = std::size_t(ref & ~DynamicRef);
+    return (ref & DynamicRef)? _dynObjs[idx] : _staticObjs[idx];
+}
+
+void Universe::_update_fraction_vision()
+{
+    // every fraction only reads the sight sets of its own objects
+    _workers.parallel_for(_fractionVisions.size(), 1, [this](std::size_t, std::size_t begin, std::size_t end)
     {
-        // was not in sight before
-        if(insight)
+        for(auto i = begin; i < end; ++i)
         {
-            // but is now
-            sightSet.insert(id);
-            subj->on_vision(to);
-            std::cout << subj->name() << " sees " << to->name() << std::endl;
+            _detect_fraction_vision(_fractionVisions[i]);
         }
-        
-    } else {
-        // was in sight
-        if(!insight)
+    });
+
+    for(auto& vision : _fractionVisions)
+    {
+        auto fraction = vision.fraction;
+        fraction->_visible.clear();
+        for(auto ref : vision.visible)
+        {
+            fraction->_visible.push_back(from_sight_ref(ref));
+        }
+
+        for(auto& e : vision.events)
         {
-            // but not anymore
-            sightSet.erase(it);
-            subj->on_vision_lost(to);
-            std::cout << subj->name() << " lost " << to->name() << std::endl;
-            std::cout << "(" << subj->position() << ", " << to->position() << ")\n";
+            auto obj = from_sight_ref(e.first);
+            auto& event = e.second? fraction->_onVision : fraction->_onVisionLost;
+            if(event.has_subscribers())
+                event.notify(obj->id().resolve());
+            SC_LOG(Debug, Universe) << fraction->name() << (e.second? " sees " : " lost ") << obj->name();
         }
     }
 }
+
+void Universe::_detect_fraction_vision(FractionVision& vision) const
+{
+    auto& current = vision.current;
+    current = vision.members;
+    for(auto ref : vision.members)
+    {
+        auto& inSight = from_sight_ref(ref)->_inSight;
+        current.insert(current.end(), inSight.begin(), inSight.end());
+    }
+    std::sort(current.begin(), current.end());
+    current.erase(std::unique(current.begin(), current.end()), current.end());
+
+    vision.events.clear();
+    diff_sorted(vision.visible, current, [&vision](std::uint32_t ref, bool insight)
+    {
+        vision.events.emplace_back(ref, insight);
+    });
+    vision.visible.swap(current);
+}
+
+bool Universe::SightEvent::operator <(const SightEvent& other) const
+{
+    // for the same object, static objects were checked before dynamic ones
+    return std::make_tuple(first, pass != Static, second, pass) < std::make_tuple(other.first, other.pass != Static, other.second, other.pass);
+}
+
+void Universe::_fire_sight(GameObject* subj, GameObject* to, bool insight)
+{
+    if(insight)
+    {
+        subj->on_vision(to->id().resolve());
+        SC_LOG(Debug, Universe) << subj->name() << " sees " << to->name();
+    } else {
+        subj->on_vision_lost(to->id().resolve());
+        SC_LOG(Debug, Universe) << subj->name() << " lost " << to->name()
+                                << " (" << subj->position() << ", " << to->position() << ")";
+    }
+}
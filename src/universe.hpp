@@ -1,20 +1,94 @@
 #pragma once
 
 #include <boost/noncopyable.hpp>
-#include <list>
+#include <vector>
 #include "game_object.hpp"
+#include "spatial_hash.hpp"
+#include "motion_store.hpp"
+#include "worker_pool.hpp"
+#include "fraction.hpp"
 
 class Universe: boost::noncopyable
 {
+    friend class GameObject;
 public:
-    void add_object(std::shared_ptr<GameObject> obj);
+    explicit Universe(unsigned int threads = 1);
+
+    void add_object(const obj_ptr& obj);
 
     void update(float dt);
 
+    MotionStore& motion();
+
 private:
-    void _check_sight(const obj_ptr& from, const obj_ptr& to, bool insight);
+    // A change of vision found by the parallel sight detection.
+    // (first, pass, second) is the position the check had in a sequential
+    // scan over all pairs, events are fired sorted by it.
+    struct SightEvent
+    {
+        enum Pass : unsigned char
+        {
+            Static,     // _dynObjs[first] -> _staticObjs[second]
+            Forward,    // _dynObjs[first] -> _dynObjs[second]
+            Backward    // _dynObjs[second] -> _dynObjs[first]
+        };
+
+        std::size_t first;
+        Pass pass;
+        std::size_t second;
+        bool insight;
+
+        bool operator <(const SightEvent& other) const;
+    };
+
+    struct SightScratch
+    {
+        std::vector<std::uint32_t> current;
+        std::vector<SightEvent> events;
+    };
+
+    // Objects in sight are remembered as sorted references: the index in
+    // _staticObjs, or the index in _dynObjs with DynamicRef set.
+    static const std::uint32_t DynamicRef = 0x80000000u;
+    static std::uint32_t sight_ref(const GameObject* obj);
+    GameObject* from_sight_ref(std::uint32_t ref) const;
+
+    // shared vision of a fraction, as sorted sight references
+    struct FractionVision
+    {
+        Fraction* fraction;
+        std::vector<std::uint32_t> members;
+        std::vector<std::uint32_t> visible;
+        std::vector<std::uint32_t> current;
+        std::vector<std::pair<std::uint32_t, bool>> events;
+    };
+
+    void _on_moved(GameObject* obj);
+    void _detect_sight(std::size_t idx, SightScratch& scratch) const;
+    void _fire_sight(GameObject* from, GameObject* to, bool insight);
+    void _update_fraction_vision();
+    void _detect_fraction_vision(FractionVision& vision) const;
 
 private:
-    std::list<obj_ptr> _dynObjs{};
-    std::list<obj_ptr> _staticObjs{};
+    // must outlive the objects, which release their handles on destruction
+    MotionStore _motion{};
+
+    // Owned by the game's object registry, in order of insertion.
+    // Not the registry's dense array: sight references and event order
+    // depend on these indices staying put, which erasing from the slot map
+    // does not guarantee, and the sight scan runs over dynamic objects only.
+    std::vector<GameObject*> _dynObjs{};
+    std::vector<GameObject*> _staticObjs{};
+
+    // spatial lookup, cell size follows the biggest sight in the universe
+    float _maxSight = 0.0f;
+    SpatialHash _dynGrid;
+    SpatialHash _staticGrid;
+
+    WorkerPool _workers;
+    // one per sight chunk, reused between ticks
+    std::vector<SightScratch> _sightScratch{};
+    std::vector<SightEvent> _sightEvents{};
+
+    std::vector<FractionVision> _fractionVisions{};
 };
@@ -0,0 +1,73 @@
+#include "worker_pool.hpp"
+
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : _work(new boost::asio::io_service::work(_service))
+{
+    for(unsigned int i = 1; i < threads; ++i)
+    {
+        _threads.emplace_back([this]{ _service.run(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    _work.reset();
+    _service.stop();
+    for(auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+unsigned int WorkerPool::size() const
+{
+    return unsigned(_threads.size()) + 1;
+}
+
+std::size_t WorkerPool::chunk_count(std::size_t count, std::size_t grain)
+{
+    assert(grain > 0);
+    return (count + grain - 1) / grain;
+}
+
+void WorkerPool::parallel_for(std::size_t count, std::size_t grain, const chunk_func& func)
+{
+    const std::size_t chunks = chunk_count(count, grain);
+    if(!chunks)
+        return;
+
+    const std::size_t helpers = std::min(_threads.size(), chunks - 1);
+    std::atomic<std::size_t> next{0};
+    std::size_t finished = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto work = [&]
+    {
+        std::size_t chunk;
+        while((chunk = next++) < chunks)
+        {
+            func(chunk, chunk * grain, std::min(count, (chunk + 1) * grain));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++finished;
+        cv.notify_all();
+    };
+
+    for(std::size_t i = 0; i < helpers; ++i)
+    {
+        _service.post(work);
+    }
+    work();
+
+    // helpers reference this frame, wait for all of them and not only for the chunks
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]{ return finished == helpers + 1; });
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+
+// Fixed set of threads to split data parallel work into chunks.
+// The calling thread always takes part, so a pool of size 1 spawns no threads.
+class WorkerPool: boost::noncopyable
+{
+public:
+    // called with (chunk index, begin, end)
+    using chunk_func = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+    explicit WorkerPool(unsigned int threads);
+    ~WorkerPool();
+
+    unsigned int size() const;
+
+    static std::size_t chunk_count(std::size_t count, std::size_t grain);
+
+    // splits [0, count) into chunks of grain elements and blocks until all are processed
+    void parallel_for(std::size_t count, std::size_t grain, const chunk_func& func);
+
+private:
+    boost::asio::io_service _service;
+    std::unique_ptr<boost::asio::io_service::work> _work;
+    std::vector<std::thread> _threads;
+};
@@ -134,3 +134,33 @@ struct test_function_binding
     }
 };
 TEST_BINDING(std::string, test_function_binding, R"(test((i) => {assert(i == 5, "i should be 5")}))", "blub");
+
+struct test_vec2_binding
+{
+    const int assert_calls = 0;
+    vec2 test(const vec2& v)
+    {
+        BOOST_CHECK_CLOSE(v.x, 1.5, 0.1);
+        BOOST_CHECK_CLOSE(v.y, -2.0, 0.1);
+
+        return vec2(3, 4);
+    }
+};
+TEST_BINDING(std::string, test_vec2_binding, R"(JSON.stringify([test({x: 1.5, y: -2}), test({y: -2, x: 1.5})]))", R"([{"x":3,"y":4},{"x":3,"y":4}])");
+
+struct test_vec2_array_binding
+{
+    const int assert_calls = 0;
+    Vec2Array test(const Vec2Array& positions)
+    {
+        BOOST_REQUIRE_EQUAL(positions.values.size(), 2u);
+        BOOST_CHECK_CLOSE(positions.values[1].x, 3.0, 0.1);
+        BOOST_CHECK_CLOSE(positions.values[1].y, 4.0, 0.1);
+
+        return Vec2Array{{vec2(1, 2), vec2(-3, 0.5)}};
+    }
+};
+TEST_BINDING(std::string, test_vec2_array_binding, R"(
+    let result = test(new Float32Array([1, 2, 3, 4]));
+    (result instanceof Float32Array) + ":" + result.join(",")
+)", "true:1,2,-3,0.5");
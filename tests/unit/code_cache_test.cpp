@@ -0,0 +1,153 @@
+#include <testx/testx.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "scripting/processor.hpp"
+#include "scripting/code_cache.hpp"
+
+namespace {
+    const auto Code = FileSystem::Intern("(function(a) { return a * 2; })(21)");
+
+    v8::Local<v8::Context> init_ctx(v8::Isolate* iso)
+    {
+        return v8::Context::New(iso);
+    }
+
+    // compiles and runs Code in its own isolate
+    int run_in_new_isolate(V8ProcessorPool& pool, CodeCache& cache)
+    {
+        int result = 0;
+        auto proc = pool.newProcessor(std::chrono::milliseconds(500), &init_ctx);
+        proc->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            auto script = cache.compile(iso, ctx, Code).ToLocalChecked();
+            result = script->Run(ctx).ToLocalChecked()->Int32Value(ctx).FromJust();
+        });
+        pool.update_all();
+        return result;
+    }
+
+    // compiles and runs all codes in one isolate
+    std::vector<int> run_all(V8ProcessorPool& pool, CodeCache& cache, const std::vector<CodeCache::Blob>& codes)
+    {
+        std::vector<int> results;
+        auto proc = pool.newProcessor(std::chrono::milliseconds(500), &init_ctx);
+        proc->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            for(auto& code : codes)
+            {
+                auto script = cache.compile(iso, ctx, code).ToLocalChecked();
+                results.push_back(script->Run(ctx).ToLocalChecked()->Int32Value(ctx).FromJust());
+            }
+        });
+        pool.update_all();
+        return results;
+    }
+
+    // scripts of the same size, returning 10 to 29
+    std::vector<CodeCache::Blob> numbered_codes()
+    {
+        std::vector<CodeCache::Blob> codes;
+        for(int i = 10; i < 30; ++i)
+        {
+            codes.push_back(FileSystem::Intern("(function() { return " + std::to_string(i) + "; })()"));
+        }
+        return codes;
+    }
+
+    std::uintmax_t directory_bytes(const boost::filesystem::path& dir)
+    {
+        std::uintmax_t bytes = 0;
+        for(auto& f : boost::filesystem::directory_iterator(dir))
+        {
+            bytes += boost::filesystem::file_size(f.path());
+        }
+        return bytes;
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_code_cache_shared_between_isolates)
+{
+    auto pool = V8ProcessorPool::Create(2);
+    CodeCache cache;
+
+    BOOST_CHECK_EQUAL(run_in_new_isolate(*pool, cache), 42);
+    BOOST_CHECK_EQUAL(cache.stats().misses, 1);
+    BOOST_CHECK_EQUAL(cache.stats().hits, 0);
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+
+    BOOST_CHECK_EQUAL(run_in_new_isolate(*pool, cache), 42);
+    BOOST_CHECK_EQUAL(run_in_new_isolate(*pool, cache), 42);
+    BOOST_CHECK_EQUAL(cache.stats().misses, 1);
+    BOOST_CHECK_EQUAL(cache.stats().hits, 2);
+    BOOST_CHECK_EQUAL(cache.stats().rejected, 0);
+}
+
+TESTX_AUTO_TEST_CASE(test_code_cache_on_disk)
+{
+    auto pool = V8ProcessorPool::Create(1);
+    auto dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+    {
+        CodeCache cache;
+        cache.set_directory(dir.string());
+        BOOST_CHECK_EQUAL(run_in_new_isolate(*pool, cache), 42);
+        BOOST_CHECK_EQUAL(cache.stats().misses, 1);
+    }
+
+    // a fresh cache, as after a restart
+    {
+        CodeCache cache;
+        cache.set_directory(dir.string());
+        BOOST_CHECK_EQUAL(run_in_new_isolate(*pool, cache), 42);
+        BOOST_CHECK_EQUAL(cache.stats().misses, 0);
+        BOOST_CHECK_EQUAL(cache.stats().hits, 1);
+    }
+
+    boost::filesystem::remove_all(dir);
+}
+
+TESTX_AUTO_TEST_CASE(test_code_cache_bounded)
+{
+    auto pool = V8ProcessorPool::Create(1);
+    auto dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    auto codes = numbered_codes();
+
+    std::size_t entryBytes;
+    {
+        CodeCache cache;
+        run_all(*pool, cache, {codes.front()});
+        entryBytes = cache.bytes();
+    }
+
+    // room for five entries
+    const std::size_t capacity = entryBytes * 5 + entryBytes / 2;
+    {
+        CodeCache cache;
+        cache.set_capacity(capacity);
+        cache.set_directory(dir.string());
+        BOOST_CHECK_EQUAL(run_all(*pool, cache, codes).back(), 29);
+        BOOST_CHECK_EQUAL(cache.size(), 5);
+        BOOST_CHECK_LE(cache.bytes(), capacity);
+        BOOST_CHECK_LE(directory_bytes(dir), capacity);
+
+        // the newest are kept, the oldest were dropped
+        run_all(*pool, cache, {codes.back(), codes.front()});
+        BOOST_CHECK_EQUAL(cache.stats().hits, 1);
+        BOOST_CHECK_EQUAL(cache.stats().misses, codes.size() + 1);
+    }
+
+    // a restart with less room keeps the most recently used files only
+    {
+        CodeCache cache;
+        cache.set_capacity(entryBytes * 2 + entryBytes / 2);
+        cache.set_directory(dir.string());
+        BOOST_CHECK_LE(directory_bytes(dir), entryBytes * 2 + entryBytes / 2);
+        BOOST_CHECK_EQUAL(run_all(*pool, cache, {codes.front(), codes[codes.size() - 2]}).front(), 10);
+        BOOST_CHECK_EQUAL(cache.stats().hits, 1);
+        BOOST_CHECK_EQUAL(cache.stats().misses, 1);
+    }
+
+    boost::filesystem::remove_all(dir);
+}
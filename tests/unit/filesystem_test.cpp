@@ -1,7 +1,40 @@
 #include "objects/component/filesystem.hpp"
 
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
 #include <testx/testx.hpp>
 
+// Replaces the allocation functions of the whole test binary, not just of
+// this file. Keep them as plain as this.
+namespace {
+    // counts the allocations of this thread while set
+    thread_local bool countAllocations = false;
+    thread_local std::size_t allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    if(countAllocations)
+        ++allocations;
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// not inlined, gcc takes free() of a pointer from the inlined new for a mismatch
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
 
 TESTX_AUTO_TEST_CASE(test_fs_read_write)
 {
@@ -58,6 +91,143 @@ TESTX_AUTO_TEST_CASE(test_semver)
 }
 
 
+TESTX_AUTO_TEST_CASE(test_semver_index)
+{
+    FileSystem fs;
+
+    fs.write("", "boot/boot-1.js", "v1");
+    fs.write("", "boot/boot-2.js", "v2");
+    fs.write("", "boot/boot-10.js", "v10");
+    fs.write("", "boot/boot-3.txt", "other suffix");
+    fs.write("", "boot/boot-1.9.js", "v1.9");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-^.js"), "v10");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-^.txt"), "other suffix");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-1^.js"), "v1.9");
+    BOOST_CHECK(!fs.exists("", "boot/boot-^.json"));
+    BOOST_CHECK(!fs.exists("", "boot/boot-^"));
+
+    // versions follow erased and newly written files
+    fs.erase("", "boot/boot-10.js");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-^.js"), "v2");
+    fs.write("", "boot/boot-2.0.1.js", "v2.0.1");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-^.js"), "v2.0.1");
+    fs.write("", "boot/boot-2^.js", "patched");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-2.0.1.js"), "patched");
+    BOOST_CHECK_EQUAL(fs.read("", "boot/boot-2.js"), "v2");
+    for(int i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(fs.erase("", "boot/boot-^.js"));
+    }
+    BOOST_CHECK(!fs.exists("", "boot/boot-^.js"));
+    BOOST_CHECK(fs.exists("", "boot/boot-^.txt"));
+
+    // only directories are walked into
+    fs.write("", "lib-2", "file, not a dir");
+    fs.write("", "lib-1/main.js", "main");
+    BOOST_CHECK_EQUAL(fs.read("", "lib-^/main.js"), "main");
+    BOOST_CHECK_EQUAL(fs.read("", "lib-^"), "file, not a dir");
+}
+
+
+TESTX_AUTO_TEST_CASE(test_copy_on_write)
+{
+    FileSystem fleet;
+    fleet.write("", "boot/boot-1.js", "v1");
+    fleet.write("", "lib/util.js", "util");
+
+    FileSystem ship1 = fleet;
+    FileSystem ship2 = fleet;
+    BOOST_CHECK_EQUAL(ship1.read("", "boot/boot-^.js"), "v1");
+
+    ship1.write("", "boot/boot-2.js", "v2");
+    ship2.erase("", "lib/util.js");
+
+    BOOST_CHECK_EQUAL(ship1.read("", "boot/boot-^.js"), "v2");
+    BOOST_CHECK_EQUAL(ship2.read("", "boot/boot-^.js"), "v1");
+    BOOST_CHECK_EQUAL(fleet.read("", "boot/boot-^.js"), "v1");
+
+    BOOST_CHECK(ship1.exists("", "lib/util.js"));
+    BOOST_CHECK(!ship2.exists("", "lib/util.js"));
+    BOOST_CHECK(fleet.exists("", "lib/util.js"));
+
+    // untouched directories stay shared
+    BOOST_CHECK_EQUAL(&ship1.read("", "lib/util.js"), &fleet.read("", "lib/util.js"));
+}
+
+
+TESTX_AUTO_TEST_CASE(test_copies_on_threads)
+{
+    FileSystem fleet;
+    fleet.write("", "boot/boot-1.js", "v1");
+    fleet.write("", "lib/util.js", "util");
+
+    // every thread gets its copy, and the last one to write a node changes it in place
+    std::vector<FileSystem> ships(4, fleet);
+    fleet = FileSystem();
+    std::vector<std::thread> threads;
+    for(std::size_t i = 0; i < ships.size(); ++i)
+    {
+        threads.emplace_back([&ship = ships[i], i]
+        {
+            for(int round = 0; round < 200; ++round)
+            {
+                ship.write("", "boot/boot-2.js", std::to_string(i));
+                ship.read("", "lib/util.js");
+            }
+        });
+    }
+    for(auto& t : threads)
+    {
+        t.join();
+    }
+
+    for(std::size_t i = 0; i < ships.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(ships[i].read("", "boot/boot-^.js"), std::to_string(i));
+        BOOST_CHECK_EQUAL(ships[i].read("", "boot/boot-1.js"), "v1");
+    }
+}
+
+
+TESTX_AUTO_TEST_CASE(test_interned_contents)
+{
+    auto before = FileSystem::InternedBlobs();
+    {
+        FileSystem fs1, fs2;
+        fs1.write("", "a.js", "same code");
+        fs2.write("", "dir/b.js", "same code");
+        fs2.write("", "dir/c.js", "other code");
+
+        BOOST_CHECK_EQUAL(&fs1.read("", "a.js"), &fs2.read("", "dir/b.js"));
+        BOOST_CHECK_EQUAL(FileSystem::InternedBlobs(), before + 2);
+
+        fs1.write("", "a.js", "changed code");
+        BOOST_CHECK_EQUAL(FileSystem::InternedBlobs(), before + 3);
+        fs2.erase("", "dir/b.js");
+        BOOST_CHECK_EQUAL(FileSystem::InternedBlobs(), before + 2);
+    }
+    BOOST_CHECK_EQUAL(FileSystem::InternedBlobs(), before);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_open)
+{
+    FileSystem fs;
+    fs.write("", "/lib/nav-1.2.js", "v1.2");
+    fs.write("", "/lib/nav-1.10.js", "v1.10");
+    fs.write("", "/lib/data.json", "{}");
+
+    auto file = fs.open("/boot", "../lib/./nav-^.js");
+    BOOST_CHECK_EQUAL(file.path, "/lib/nav-1.10.js");
+    BOOST_CHECK_EQUAL(*file.code, "v1.10");
+    BOOST_CHECK_EQUAL(&*file.code, &fs.read("", "/lib/nav-1.10.js"));
+
+    BOOST_CHECK_EQUAL(fs.open("/lib", "nav-1.2.js").path, "/lib/nav-1.2.js");
+    BOOST_CHECK_THROW(fs.open("", "/lib/nav-2.^.js"), std::runtime_error);
+    BOOST_CHECK_THROW(fs.open("", "/lib"), std::runtime_error);
+}
+
+
 TESTX_AUTO_TEST_CASE(test_dirs)
 {
     FileSystem fs;
@@ -79,3 +249,80 @@ TESTX_AUTO_TEST_CASE(test_dirs)
     BOOST_CHECK(!fs.exists("", "root/dir/test3.txt"));
     BOOST_CHECK(fs.exists("", "root2/dir2/test4.txt"));
 }
+
+
+TESTX_AUTO_TEST_CASE(test_path_resolution)
+{
+    FileSystem fs;
+    fs.write("", "/x.js", "x");
+    fs.write("", "/lib/util.js", "util");
+
+    // ".." above the root stays at the root
+    BOOST_CHECK_EQUAL(fs.open("/a", "../../x.js").path, "/x.js");
+    BOOST_CHECK_EQUAL(fs.open("/lib", "../../../lib/util.js").path, "/lib/util.js");
+    BOOST_CHECK_THROW(fs.open("", ".."), std::runtime_error);
+
+    // repeated and trailing slashes are ignored
+    BOOST_CHECK_EQUAL(fs.open("", "//lib///util.js").path, "/lib/util.js");
+    BOOST_CHECK_EQUAL(fs.open("/lib//", "util.js").path, "/lib/util.js");
+    BOOST_CHECK(fs.type("", "lib/") == FSType::Directory);
+    BOOST_CHECK_EQUAL(fs.open("", "lib/util.js/").path, "/lib/util.js");
+
+    // an empty file is the working directory
+    BOOST_CHECK(fs.exists("", ""));
+    BOOST_CHECK(fs.type("", "") == FSType::Directory);
+    BOOST_CHECK(fs.type("/lib", "") == FSType::Directory);
+    BOOST_CHECK(!fs.exists("/nope", ""));
+    BOOST_CHECK_THROW(fs.read("/lib", ""), std::runtime_error);
+    BOOST_CHECK(fs.write("", "", "root") == nullptr);
+    BOOST_CHECK(fs.write("", "/..", "root") == nullptr);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_lookup_allocations)
+{
+    FileSystem fs;
+    fs.write("", "/boot/boot-1.2.js", "v1.2");
+    fs.write("", "/boot/boot-1.10.js", "v1.10");
+    fs.write("", "/lib/util.js", "util");
+
+    // only the results are checked afterwards, the checks allocate themselves
+    bool found = true;
+    std::size_t length = 0;
+    allocations = 0;
+    countAllocations = true;
+    for(int i = 0; i < 100; ++i)
+    {
+        found = found && fs.exists("/boot", "../lib//./util.js");
+        found = found && !fs.exists("/boot", "boot-2.^.js");
+        length += fs.read("/boot", "boot-^.js").size();
+        length += fs.read("", "/boot/boot-1.2.js").size();
+    }
+    countAllocations = false;
+
+    BOOST_CHECK(found);
+    BOOST_CHECK_EQUAL(length, 100 * 9);
+    BOOST_CHECK_EQUAL(allocations, 0);
+
+    // paths with more components than fit inline fall back to the heap, and still resolve
+    std::string deep;
+    for(int i = 0; i < 20; ++i)
+    {
+        deep += "/d" + std::to_string(i);
+    }
+    auto leaf = deep + "/leaf.js";
+    fs.write("", leaf, "deep");
+    allocations = 0;
+    countAllocations = true;
+    found = fs.exists("", leaf);
+    countAllocations = false;
+    BOOST_CHECK(found);
+    BOOST_CHECK_GT(allocations, 0);
+
+    BOOST_CHECK_EQUAL(fs.read("", leaf), "deep");
+    BOOST_CHECK_EQUAL(fs.read(deep, "../d19/./leaf.js"), "deep");
+    BOOST_CHECK_EQUAL(fs.open(deep + "/..", "d19//leaf.js").path, leaf);
+    BOOST_CHECK(!fs.exists("", deep + "/nope.js"));
+    BOOST_CHECK(fs.erase("", leaf));
+    BOOST_CHECK(!fs.exists("", leaf));
+}
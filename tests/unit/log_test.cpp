@@ -0,0 +1,67 @@
+#include "log.hpp"
+
+#include <testx/testx.hpp>
+
+
+TESTX_AUTO_TEST_CASE(test_log_levels)
+{
+    auto old = Log::level(LogCategory::Universe);
+
+    Log::set_level(LogCategory::Universe, LogLevel::Warning);
+    BOOST_CHECK(!Log::enabled(LogLevel::Debug, LogCategory::Universe));
+    BOOST_CHECK(Log::enabled(LogLevel::Warning, LogCategory::Universe));
+    BOOST_CHECK(Log::enabled(LogLevel::Error, LogCategory::Universe));
+
+    Log::set_level(LogCategory::Universe, LogLevel::Off);
+    BOOST_CHECK(!Log::enabled(LogLevel::Error, LogCategory::Universe));
+
+    Log::set_level(LogCategory::Universe, old);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_log_disabled_is_not_evaluated)
+{
+    auto old = Log::level(LogCategory::Game);
+    Log::set_level(LogCategory::Game, LogLevel::Info);
+
+    int evaluated = 0;
+    auto count = [&evaluated] { return ++evaluated; };
+
+    SC_LOG(Debug, Game) << count();
+    BOOST_CHECK_EQUAL(evaluated, 0);
+
+    SC_LOG(Info, Game) << "log test " << count();
+    BOOST_CHECK_EQUAL(evaluated, 1);
+
+    Log::flush();
+    Log::set_level(LogCategory::Game, old);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_log_is_a_single_statement)
+{
+    auto old = Log::level(LogCategory::Game);
+    Log::set_level(LogCategory::Game, LogLevel::Info);
+
+    int evaluated = 0;
+    auto count = [&evaluated] { return ++evaluated; };
+
+    // the else belongs to the outer if, not to one inside SC_LOG
+    bool elseTaken = false;
+    if(evaluated != 0)
+        SC_LOG(Info, Game) << count();
+    else
+        elseTaken = true;
+    BOOST_CHECK(elseTaken);
+    BOOST_CHECK_EQUAL(evaluated, 0);
+
+    if(evaluated == 0)
+        SC_LOG(Info, Game) << "log test " << count();
+    else
+        elseTaken = false;
+    BOOST_CHECK(elseTaken);
+    BOOST_CHECK_EQUAL(evaluated, 1);
+
+    Log::flush();
+    Log::set_level(LogCategory::Game, old);
+}
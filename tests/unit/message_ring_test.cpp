@@ -0,0 +1,125 @@
+#include <testx/testx.hpp>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "scripting/message_ring.hpp"
+
+namespace {
+    void run(ScriptMessage& msg)
+    {
+        v8::Local<v8::Context> ctx;
+        msg(nullptr, ctx);
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_message_storage)
+{
+    auto alive = std::make_shared<int>(0);
+    int called = 0;
+    {
+        // fits inline
+        ScriptMessage small([alive, &called](v8::Isolate*, v8::Local<v8::Context>&) { ++called; });
+        // too large, lives on the heap
+        std::array<char, ScriptMessage::InlineSize * 2> payload{};
+        ScriptMessage large([alive, payload, &called](v8::Isolate*, v8::Local<v8::Context>&) { called += 10 + payload[0]; });
+        BOOST_CHECK_EQUAL(alive.use_count(), 3);
+
+        ScriptMessage moved(std::move(small));
+        BOOST_CHECK(!small);
+        BOOST_CHECK(moved);
+        run(moved);
+        run(large);
+        BOOST_CHECK_EQUAL(called, 11);
+
+        moved = std::move(large);
+        BOOST_CHECK_EQUAL(alive.use_count(), 2);
+        run(moved);
+        BOOST_CHECK_EQUAL(called, 21);
+    }
+    BOOST_CHECK_EQUAL(alive.use_count(), 1);
+}
+
+TESTX_AUTO_TEST_CASE(test_message_ring_overflow_keeps_order)
+{
+    MessageRing ring(4);
+    std::vector<int> order;
+    for(int i = 0; i < 10; ++i)
+    {
+        ring.push([i, &order](v8::Isolate*, v8::Local<v8::Context>&) { order.push_back(i); });
+    }
+
+    ScriptMessage msg;
+    for(int i = 0; i < 3; ++i)
+    {
+        BOOST_REQUIRE(ring.pop(msg));
+        run(msg);
+    }
+    // space in the ring again, but the overflow is not drained yet
+    ring.push([&order](v8::Isolate*, v8::Local<v8::Context>&) { order.push_back(10); });
+    while(ring.pop(msg))
+    {
+        run(msg);
+    }
+
+    std::vector<int> expected{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    BOOST_CHECK(order == expected);
+
+    // back to the ring after the overflow was drained
+    ring.push([&order](v8::Isolate*, v8::Local<v8::Context>&) { order.push_back(11); });
+    BOOST_REQUIRE(ring.pop(msg));
+    run(msg);
+    BOOST_CHECK_EQUAL(order.back(), 11);
+    BOOST_CHECK(!ring.pop(msg));
+}
+
+TESTX_AUTO_TEST_CASE(test_message_ring_concurrent_producers)
+{
+    const int Producers = 4;
+    const int PerProducer = 10000;
+    MessageRing ring(64);
+
+    std::vector<int> last(Producers, -1);
+    bool ordered = true;
+    std::atomic<int> running{Producers};
+    std::vector<std::thread> threads;
+    for(int p = 0; p < Producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            for(int i = 0; i < PerProducer; ++i)
+            {
+                ring.push([&, p, i](v8::Isolate*, v8::Local<v8::Context>&)
+                {
+                    ordered = ordered && last[p] == i - 1;
+                    last[p] = i;
+                });
+            }
+            --running;
+        });
+    }
+
+    ScriptMessage msg;
+    int received = 0;
+    while(received < Producers * PerProducer)
+    {
+        if(ring.pop(msg))
+        {
+            run(msg);
+            ++received;
+        } else if(!running) {
+            // everything was pushed before the producers finished
+            BOOST_REQUIRE(ring.pop(msg));
+            run(msg);
+            ++received;
+        }
+    }
+    for(auto& t : threads)
+    {
+        t.join();
+    }
+
+    BOOST_CHECK(ordered);
+    BOOST_CHECK(!ring.pop(msg));
+}
@@ -0,0 +1,212 @@
+#include <testx/testx.hpp>
+#include <memory>
+#include "scripting/processor.hpp"
+#include "scripting/binding.hpp"
+#include "scripting/module_loader.hpp"
+
+namespace {
+    v8::Local<v8::Context> init_ctx(v8::Isolate* iso)
+    {
+        // modules report back through the global "out"
+        auto ctx = v8::Context::New(iso);
+        v8::Context::Scope context_scope(ctx);
+        ctx->Global()->Set(ctx, bd::str("out"), v8::Object::New(iso)).FromJust();
+        return ctx;
+    }
+
+    struct Outcome
+    {
+        bool ok = false;
+        std::string out;            // JSON of "out"
+        std::string error;
+        std::size_t modules = 0;
+    };
+
+    // a processor with a module loader, runs one round per call
+    class ModuleProcessor
+    {
+    public:
+        explicit ModuleProcessor(const FileSystem& files)
+            : _pool(V8ProcessorPool::Create(1))
+            , _proc(_pool->newProcessor(std::chrono::milliseconds(500), &init_ctx))
+        {
+            _proc->post([files](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+            {
+                auto loader = std::make_shared<ModuleLoader>(iso, files);
+                loader->install(ctx);
+                Processor::FromContext(ctx)->attach(loader);
+            });
+        }
+
+        Outcome run(const std::string& path)
+        {
+            return round([&path](v8::Local<v8::Context> ctx, ModuleLoader& loader)
+            {
+                return !loader.run(ctx, path).IsEmpty();
+            });
+        }
+
+        Outcome reload(const FileSystem& files)
+        {
+            return round([&files](v8::Local<v8::Context> ctx, ModuleLoader& loader)
+            {
+                return loader.reload(ctx, files);
+            });
+        }
+
+    private:
+        template<typename F>
+        Outcome round(F f)
+        {
+            Outcome outcome;
+            _proc->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+            {
+                auto& loader = *ModuleLoader::FromContext(ctx);
+                v8::TryCatch tryCatch(iso);
+                outcome.ok = f(ctx, loader);
+                if(tryCatch.HasCaught())
+                    outcome.error = bd::fromLocal<std::string>(iso, ctx, tryCatch.Exception());
+
+                auto out = ctx->Global()->Get(ctx, bd::str("out")).ToLocalChecked();
+                outcome.out = bd::fromLocal<std::string>(iso, ctx, v8::JSON::Stringify(ctx, out).ToLocalChecked());
+                outcome.modules = loader.modules();
+            });
+            _pool->update_all();
+            return outcome;
+        }
+
+    private:
+        std::shared_ptr<V8ProcessorPool> _pool;
+        std::shared_ptr<Processor> _proc;
+    };
+
+    // runs the module at path of files in a new processor
+    Outcome run_module(const FileSystem& files, const std::string& path)
+    {
+        return ModuleProcessor(files).run(path);
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_module_imports)
+{
+    FileSystem files;
+    files.write("", "/lib/math-1.0.js", "export const version = '1.0';");
+    files.write("", "/lib/math-1.2.js", "export const version = '1.2'; export function twice(a) { return a * 2; }");
+    files.write("", "/boot/util.js", "export const name = 'util';");
+    files.write("", "/boot/boot-1",
+                "import { version, twice } from '../lib/math-^.js';\n"
+                "import { name } from './util.js';\n"
+                "import * as again from '/lib/math-1.^.js';\n"
+                "out.version = version; out.twice = twice(21); out.name = name; out.same = again.twice === twice;");
+
+    auto outcome = run_module(files, "/boot/boot-^");
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"version\":\"1.2\",\"twice\":42,\"name\":\"util\",\"same\":true}");
+    BOOST_CHECK_EQUAL(outcome.modules, 3);
+}
+
+TESTX_AUTO_TEST_CASE(test_module_shared_import)
+{
+    // a imports b and c, which both import d
+    FileSystem files;
+    files.write("", "/d.js", "out.evaluated = (out.evaluated || 0) + 1; export const token = {};");
+    files.write("", "/b.js", "import { token } from './d.js'; export const fromB = token;");
+    files.write("", "/c.js", "import { token } from '/d.js'; export const fromC = token;");
+    files.write("", "/a.js", "import { fromB } from './b.js'; import { fromC } from './c.js'; out.same = fromB === fromC;");
+
+    auto outcome = run_module(files, "/a.js");
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"evaluated\":1,\"same\":true}");
+    BOOST_CHECK_EQUAL(outcome.modules, 4);
+}
+
+TESTX_AUTO_TEST_CASE(test_module_errors)
+{
+    FileSystem files;
+    files.write("", "/missing.js", "import { x } from './nope.js'; out.ran = true;");
+    files.write("", "/syntax.js", "export const = 1;");
+    files.write("", "/throws.js", "out.ran = true; throw new Error('boom');");
+
+    auto missing = run_module(files, "/missing.js");
+    BOOST_CHECK(!missing.ok);
+    BOOST_CHECK_EQUAL(missing.error, "Error: Cannot find module './nope.js'");
+    BOOST_CHECK_EQUAL(missing.out, "{}");
+
+    auto noFile = run_module(files, "/boot/boot-^");
+    BOOST_CHECK(!noFile.ok);
+    BOOST_CHECK_EQUAL(noFile.error, "Error: Cannot find module '/boot/boot-^'");
+
+    auto syntax = run_module(files, "/syntax.js");
+    BOOST_CHECK(!syntax.ok);
+    BOOST_CHECK_EQUAL(syntax.error.compare(0, 12, "SyntaxError:"), 0);
+
+    auto throws = run_module(files, "/throws.js");
+    BOOST_CHECK(!throws.ok);
+    BOOST_CHECK_EQUAL(throws.error, "Error: boom");
+    BOOST_CHECK_EQUAL(throws.out, "{\"ran\":true}");
+}
+
+TESTX_AUTO_TEST_CASE(test_module_hot_reload)
+{
+    FileSystem files;
+    files.write("", "/state.js", "export const state = { ticks: 0 };");
+    files.write("", "/lib/speed-1.js", "export const speed = 1; export function unload() {}");
+    files.write("", "/boot/boot-1",
+                "import { state } from '/state.js';\n"
+                "import { speed } from '../lib/speed-^.js';\n"
+                "state.ticks += speed; out.ticks = state.ticks;\n"
+                "export function unload() { out.unloaded = (out.unloaded || 0) + 1; }");
+
+    ModuleProcessor proc(files);
+    auto outcome = proc.run("/boot/boot-^");
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"ticks\":1}");
+
+    // nothing changed, nothing runs
+    files.write("", "/unused.js", "out.unused = true;");
+    outcome = proc.reload(files);
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"ticks\":1}");
+
+    // the import and its importer are replaced, state.js keeps its state
+    files.write("", "/lib/speed-1.js", "export const speed = 10; export function unload() {}");
+    outcome = proc.reload(files);
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"ticks\":11,\"unloaded\":1}");
+    BOOST_CHECK_EQUAL(outcome.modules, 3);
+
+    // a '^' import resolving to a newer version
+    files.write("", "/lib/speed-2.js", "export const speed = 100;");
+    outcome = proc.reload(files);
+    BOOST_CHECK(outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"ticks\":111,\"unloaded\":2}");
+
+    // speed-2.js can not be unloaded
+    files.write("", "/lib/speed-2.js", "export const speed = 1000;");
+    outcome = proc.reload(files);
+    BOOST_CHECK(!outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.out, "{\"ticks\":111,\"unloaded\":2}");
+}
+
+TESTX_AUTO_TEST_CASE(test_module_hot_reload_failures)
+{
+    FileSystem files;
+    files.write("", "/boot/boot-1", "export function unload() { throw new Error('stuck'); }");
+
+    // only a running module can be reloaded
+    FileSystem broken;
+    broken.write("", "/boot/boot-1", "import './nope.js';");
+    ModuleProcessor notRunning(broken);
+    BOOST_CHECK(!notRunning.run("/boot/boot-^").ok);
+    BOOST_CHECK(!notRunning.reload(files).ok);
+
+    ModuleProcessor proc(files);
+    BOOST_CHECK(proc.run("/boot/boot-^").ok);
+
+    // a newer boot version replaces the old one, but it refuses to unload
+    files.write("", "/boot/boot-2", "out.booted = 2;");
+    auto outcome = proc.reload(files);
+    BOOST_CHECK(!outcome.ok);
+    BOOST_CHECK_EQUAL(outcome.error, "Error: stuck");
+    BOOST_CHECK_EQUAL(outcome.out, "{}");
+}
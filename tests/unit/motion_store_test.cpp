@@ -0,0 +1,181 @@
+#include <testx/testx.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <boost/optional.hpp>
+#include "motion_store.hpp"
+
+namespace {
+    const float Dt = 0.05f;
+    const float Tolerance = 1e-3f;
+
+    struct Body
+    {
+        vec2 position;
+        vec2 velocity;
+        boost::optional<vec2> target;
+        float acceleration;
+        float maxSpeed;
+        bool dynamic;
+    };
+
+    // the per object steering GameObject::_update did before the MotionStore
+    void steer(Body& b, float dt)
+    {
+        if(b.target)
+        {
+            auto to = *b.target;
+            auto path = to - b.position;
+            if (glm::length(path) <= 0.1) {
+                if (glm::length(b.velocity) <= 0.1) {
+                    b.position = to;
+                    b.velocity = vec2();
+                } else {
+                    b.velocity -= glm::normalize(b.velocity) * std::min(glm::length(b.velocity), b.acceleration) * dt;
+                }
+            } else {
+                auto dir = glm::normalize(path);
+                auto optProj = glm::dot(dir, b.velocity) * dir;
+                auto pathToOpt = optProj - b.velocity;
+                auto pathLenToOpt = glm::length(pathToOpt) * dt;
+                auto curAcc = b.acceleration * dt;
+                if (pathLenToOpt < curAcc) {
+                    auto rest = curAcc - pathLenToOpt;
+                    b.velocity = optProj;
+                    auto speed = glm::length(b.velocity);
+                    auto neededSecToTarget = speed > 0? glm::length(path) / speed : std::numeric_limits<float>::infinity();
+                    auto secsToStop = speed / b.acceleration;
+                    b.velocity += dir * rest * (secsToStop < neededSecToTarget? 1.0f : -1.0f);
+                } else {
+                    b.velocity += glm::normalize(pathToOpt) * curAcc;
+                }
+            }
+            auto speed = glm::length(b.velocity);
+            if(speed > b.maxSpeed)
+                b.velocity *= b.maxSpeed / speed;
+        } else {
+            auto speed = glm::length(b.velocity);
+            auto dtAcc = dt * b.acceleration;
+            if(dtAcc < speed)
+            {
+                b.velocity *= 1.f - (dtAcc / speed);
+            }else{
+                b.velocity = vec2();
+            }
+        }
+        b.position += dt * b.velocity;
+    }
+
+    // 4 lanes of a batch and a remainder of 3, with every steering branch
+    std::vector<Body> bodies()
+    {
+        std::vector<Body> result;
+        for(int i = 0; i < 19; ++i)
+        {
+            float f = float(i);
+            Body b{vec2(f * 3.f - 20.f, 7.f - f), vec2(std::sin(f) * 5.f, std::cos(f) * 5.f), boost::none, 2.f + f * 0.25f, 6.f + f, i % 5 != 4};
+            if(i % 3 != 0)
+                b.target = vec2(f * -2.f, f * 1.5f + 3.f);
+            result.push_back(b);
+        }
+
+        // already on the target and slow, snaps in the first step
+        result.push_back(Body{vec2(10.05f, -4.f), vec2(0.05f, 0.f), vec2(10.f, -4.f), 4.f, 10.f, true});
+        // on the target but too fast, brakes first
+        result.push_back(Body{vec2(-3.f, 2.02f), vec2(1.f, 0.5f), vec2(-3.f, 2.f), 4.f, 10.f, true});
+        // standing still without target
+        result.push_back(Body{vec2(1.f, 1.f), vec2(), boost::none, 4.f, 10.f, true});
+        // static, never moves
+        result.push_back(Body{vec2(5.f, 5.f), vec2(3.f, 3.f), vec2(0.f, 0.f), 4.f, 10.f, false});
+        return result;
+    }
+
+    void fill(MotionStore& store, const std::vector<Body>& bs)
+    {
+        for(auto& b : bs)
+        {
+            auto h = store.allocate();
+            store.set_position(h, b.position);
+            store.set_velocity(h, b.velocity);
+            if(b.target)
+                store.set_target(h, *b.target);
+            store.set_limits(h, b.acceleration, b.maxSpeed);
+            store.set_dynamic(h, b.dynamic);
+        }
+    }
+
+    bool close(const vec2& a, const vec2& b)
+    {
+        return std::abs(a.x - b.x) <= Tolerance && std::abs(a.y - b.y) <= Tolerance;
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_motion_batch_matches_scalar)
+{
+    auto reference = bodies();
+    MotionStore batch, single;
+    fill(batch, reference);
+    fill(single, reference);
+    BOOST_REQUIRE_EQUAL(batch.size() % 4, 3);
+
+    for(int step = 0; step < 400; ++step)
+    {
+        batch.integrate(Dt);
+        // ranges shorter than a batch take the scalar path only
+        for(std::size_t i = 0; i < single.size(); ++i)
+        {
+            single.integrate(Dt, i, i + 1);
+        }
+        for(auto& b : reference)
+        {
+            if(b.dynamic)
+                steer(b, Dt);
+        }
+
+        for(std::size_t i = 0; i < reference.size(); ++i)
+        {
+            auto h = MotionStore::handle(i);
+            BOOST_REQUIRE(close(batch.position(h), single.position(h)));
+            BOOST_REQUIRE(close(batch.velocity(h), single.velocity(h)));
+            BOOST_REQUIRE(close(batch.position(h), reference[i].position));
+            BOOST_REQUIRE(close(batch.velocity(h), reference[i].velocity));
+        }
+    }
+
+    // arrived objects sit exactly on their target, GameObject::arrived() relies on it
+    std::size_t arrived = 0;
+    for(std::size_t i = 0; i < reference.size(); ++i)
+    {
+        auto& b = reference[i];
+        auto h = MotionStore::handle(i);
+        if(!b.target || !b.dynamic || b.velocity != vec2())
+            continue;
+        ++arrived;
+        BOOST_CHECK(b.position == *b.target);
+        BOOST_CHECK(batch.position(h) == *b.target);
+        BOOST_CHECK(single.position(h) == *b.target);
+        BOOST_CHECK(batch.velocity(h) == vec2());
+    }
+    BOOST_CHECK_GE(arrived, 5);
+
+    auto snapped = MotionStore::handle(reference.size() - 4);
+    BOOST_CHECK(batch.position(snapped) == vec2(10.f, -4.f));
+    auto braked = MotionStore::handle(reference.size() - 3);
+    BOOST_CHECK(batch.position(braked) == vec2(-3.f, 2.f));
+    auto fixed = MotionStore::handle(reference.size() - 1);
+    BOOST_CHECK(batch.position(fixed) == vec2(5.f, 5.f));
+    BOOST_CHECK(batch.velocity(fixed) == vec2(3.f, 3.f));
+}
+
+TESTX_AUTO_TEST_CASE(test_motion_first_step_snaps)
+{
+    MotionStore store;
+    auto bs = bodies();
+    fill(store, bs);
+
+    store.integrate(Dt);
+    auto h = MotionStore::handle(bs.size() - 4);
+    BOOST_CHECK(store.position(h) == vec2(10.f, -4.f));
+    BOOST_CHECK(store.velocity(h) == vec2());
+}
@@ -0,0 +1,60 @@
+#include "object_pool.hpp"
+
+#include <set>
+#include <testx/testx.hpp>
+
+
+TESTX_AUTO_TEST_CASE(test_fixed_pool_reuse)
+{
+    FixedPool pool(24, 4);
+
+    auto a = pool.allocate();
+    auto b = pool.allocate();
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(pool.capacity(), 4);
+
+    pool.deallocate(a);
+    BOOST_CHECK(pool.allocate() == a);
+
+    // grows by whole chunks
+    std::set<void*> blocks{a, b};
+    for(int i = 0; i < 6; ++i)
+    {
+        blocks.insert(pool.allocate());
+    }
+    BOOST_CHECK_EQUAL(blocks.size(), 8);
+    BOOST_CHECK_EQUAL(pool.capacity(), 8);
+}
+
+
+namespace {
+    struct pooled_test_object
+    {
+        pooled_test_object(int value)
+            : value(value)
+        {
+        }
+        int value;
+        double payload[4];
+    };
+}
+
+TESTX_AUTO_TEST_CASE(test_pool_allocator_shared)
+{
+    PoolAllocator<pooled_test_object> alloc;
+
+    auto first = std::allocate_shared<pooled_test_object>(alloc, 1);
+    auto second = std::allocate_shared<pooled_test_object>(alloc, 2);
+    BOOST_CHECK_EQUAL(first->value, 1);
+    BOOST_CHECK_EQUAL(second->value, 2);
+
+    // object and control block share a block, and blocks of one chunk are adjacent
+    auto distance = reinterpret_cast<char*>(second.get()) - reinterpret_cast<char*>(first.get());
+    BOOST_CHECK(distance > 0);
+    BOOST_CHECK(std::size_t(distance) < 2 * sizeof(pooled_test_object) + 64);
+
+    auto address = second.get();
+    second.reset();
+    auto third = std::allocate_shared<pooled_test_object>(alloc, 3);
+    BOOST_CHECK(third.get() == address);
+}
@@ -1,5 +1,6 @@
 #include <testx/testx.hpp>
 #include <iostream>
+#include <vector>
 #include "scripting/processor.hpp"
 
 auto init_default_ctx(v8::Isolate* iso)
@@ -129,3 +130,146 @@ TESTX_AUTO_TEST_CASE(test_callback)
 
     pool->update_all();
 }
+
+TESTX_AUTO_TEST_CASE(test_overrunning_script_is_suspended)
+{
+    auto pool = V8ProcessorPool::Create(2);
+
+    std::atomic<int> done{0};
+    auto endless = pool->newProcessor(std::chrono::milliseconds(5), &init_default_ctx);
+    endless->post([](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+    {
+        v8::Local<v8::String> source = v8::String::NewFromUtf8(iso, "while(true) {}", v8::NewStringType::kNormal).ToLocalChecked();
+        v8::Script::Compile(ctx, source).ToLocalChecked()->Run(ctx);
+    });
+
+    std::list<std::shared_ptr<Processor>> processors{};
+    for(int i = 0; i < 16; ++i) {
+        processors.push_back(pool->newProcessor(std::chrono::milliseconds(5), &init_default_ctx));
+    }
+
+    // the endless script must neither block the round nor the other processors
+    for(int round = 0; round < 3; ++round) {
+        for(const auto& p : processors) {
+            p->post([&done](v8::Isolate*, v8::Local<v8::Context>&) {
+                ++done;
+            });
+        }
+        pool->update_all();
+        BOOST_CHECK_EQUAL(done, (round + 1) * 16);
+    }
+
+    // destroying it terminates the suspended script
+    endless.reset();
+    pool->update_all();
+}
+
+TESTX_AUTO_TEST_CASE(test_round_stats)
+{
+    auto pool = V8ProcessorPool::Create(2);
+
+    ScriptBudget budget;
+    budget.per_round = std::chrono::milliseconds(2);
+    budget.max_credit = std::chrono::milliseconds(3);
+    budget.max_debt = std::chrono::milliseconds(10);
+
+    auto idle = pool->newProcessor(budget, &init_default_ctx);
+    auto busy = pool->newProcessor(budget, &init_default_ctx);
+    busy->post([](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+    {
+        v8::Local<v8::String> source = v8::String::NewFromUtf8(iso, "while(true) {}", v8::NewStringType::kNormal).ToLocalChecked();
+        v8::Script::Compile(ctx, source).ToLocalChecked()->Run(ctx);
+    });
+
+    for(int round = 0; round < 4; ++round) {
+        pool->update_all();
+    }
+
+    // unused time is carried over, but only up to max_credit
+    auto idleStats = idle->stats();
+    BOOST_CHECK_EQUAL(idleStats.rounds, 4);
+    BOOST_CHECK_EQUAL(idleStats.suspended, 0);
+    BOOST_CHECK(idleStats.balance == budget.max_credit);
+    BOOST_CHECK(idleStats.allowance == budget.per_round + budget.max_credit);
+
+    // the endless script uses its whole budget every round it runs
+    auto busyStats = busy->stats();
+    BOOST_CHECK_EQUAL(busyStats.rounds, 4);
+    BOOST_CHECK_EQUAL(busyStats.suspended + busyStats.skipped, 4);
+    BOOST_CHECK(busyStats.balance <= std::chrono::nanoseconds::zero());
+    BOOST_CHECK(busyStats.balance >= -budget.max_debt);
+}
+
+TESTX_AUTO_TEST_CASE(test_idle_processors_are_not_scheduled)
+{
+    auto pool = V8ProcessorPool::Create(2);
+
+    std::vector<std::shared_ptr<Processor>> processors;
+    for(int i = 0; i < 16; ++i) {
+        processors.push_back(pool->newProcessor(std::chrono::milliseconds(100), &init_default_ctx));
+    }
+
+    int runs = 0;
+    auto& busy = processors.front();
+    busy->post([&runs](v8::Isolate*, v8::Local<v8::Context>&) { ++runs; });
+    pool->update_all();
+    pool->update_all();
+    busy->post([&runs](v8::Isolate*, v8::Local<v8::Context>&) { ++runs; });
+    pool->update_all();
+
+    BOOST_CHECK_EQUAL(runs, 2);
+    BOOST_CHECK_EQUAL(busy->stats().rounds, 3);
+    BOOST_CHECK_EQUAL(busy->stats().idle, 1);
+
+    // idle processors are never entered, their isolate is not even created
+    for(std::size_t i = 1; i < processors.size(); ++i) {
+        auto stats = processors[i]->stats();
+        BOOST_CHECK_EQUAL(stats.rounds, 3);
+        BOOST_CHECK_EQUAL(stats.idle, 3);
+        BOOST_CHECK_EQUAL(stats.heap_used, 0);
+    }
+    BOOST_CHECK_EQUAL(pool->memory_stats().processors, processors.size());
+}
+
+TESTX_AUTO_TEST_CASE(test_heap_limit)
+{
+    auto pool = V8ProcessorPool::Create(2);
+
+    ScriptBudget budget;
+    budget.per_round = std::chrono::seconds(10);
+    budget.heap_limit_mb = 16;
+
+    auto run = [](const std::shared_ptr<Processor>& proc, const char* code)
+    {
+        proc->post([code](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            v8::Local<v8::String> source = v8::String::NewFromUtf8(iso, code, v8::NewStringType::kNormal).ToLocalChecked();
+            v8::Script::Compile(ctx, source).ToLocalChecked()->Run(ctx);
+        });
+    };
+
+    bool ranAfterLimit = false;
+    auto hog = pool->newProcessor(budget, &init_default_ctx);
+    auto modest = pool->newProcessor(budget, &init_default_ctx);
+    run(hog, "var hog = []; while(true) { hog.push(new Array(1000).fill(1.5)); }");
+    hog->post([&ranAfterLimit](v8::Isolate*, v8::Local<v8::Context>&) { ranAfterLimit = true; });
+    run(modest, "var data = new Array(1000).fill(1.5);");
+    pool->update_all();
+
+    // only the processor over its limit is terminated
+    auto hogStats = hog->stats();
+    BOOST_CHECK(hogStats.out_of_memory);
+    BOOST_CHECK(!ranAfterLimit);
+    BOOST_CHECK(!modest->stats().out_of_memory);
+    BOOST_CHECK(modest->stats().heap_used > 0);
+
+    auto memory = pool->memory_stats();
+    BOOST_CHECK_EQUAL(memory.processors, 2);
+    BOOST_CHECK_EQUAL(memory.out_of_memory, 1);
+    BOOST_CHECK_EQUAL(memory.largest_heap, std::max(hogStats.heap_used, modest->stats().heap_used));
+    BOOST_CHECK_EQUAL(memory.heap_used, hogStats.heap_used + modest->stats().heap_used);
+
+    // a terminated processor runs nothing anymore
+    pool->update_all();
+    BOOST_CHECK(!ranAfterLimit);
+}
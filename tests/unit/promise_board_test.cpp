@@ -0,0 +1,91 @@
+#include <testx/testx.hpp>
+#include "scripting/processor.hpp"
+#include "scripting/promise_board.hpp"
+
+namespace {
+    struct Waiter
+    {
+        PromiseBoard board;
+        bool ready = false;
+
+        static void wait(const v8::FunctionCallbackInfo<v8::Value>& info)
+        {
+            auto self = static_cast<Waiter*>(info.Data().As<v8::External>()->Value());
+            auto ctx = info.GetIsolate()->GetCurrentContext();
+            bool fail = info[0]->BooleanValue(ctx).FromJust();
+            info.GetReturnValue().Set(self->board.add(ctx, [self, fail]() -> boost::optional<PromiseBoard::Outcome>
+            {
+                if(!self->ready)
+                    return boost::none;
+                if(fail)
+                    return PromiseBoard::Reject("failed");
+                return PromiseBoard::Resolve(42);
+            }));
+        }
+
+        v8::Local<v8::Context> init_ctx(v8::Isolate* iso)
+        {
+            auto ctx = v8::Context::New(iso);
+            PromiseBoard::Install(ctx);
+            auto func = v8::Function::New(ctx, &Waiter::wait, v8::External::New(iso, this)).ToLocalChecked();
+            ctx->Global()->Set(ctx, bd::str("wait"), func).FromJust();
+            return ctx;
+        }
+    };
+
+    void run(const std::shared_ptr<Processor>& proc, const char* code)
+    {
+        proc->post([code](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            v8::Script::Compile(ctx, bd::str(code)).ToLocalChecked()->Run(ctx).ToLocalChecked();
+        });
+    }
+
+    int read_int(const std::shared_ptr<Processor>& proc, V8ProcessorPool& pool, const char* code)
+    {
+        int result = 0;
+        proc->post([code, &result](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            auto value = v8::Script::Compile(ctx, bd::str(code)).ToLocalChecked()->Run(ctx).ToLocalChecked();
+            result = value->Int32Value(ctx).FromJust();
+        });
+        pool.update_all();
+        return result;
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_promises_settled_between_rounds)
+{
+    auto pool = V8ProcessorPool::Create(1);
+    Waiter waiter;
+    auto proc = pool->newProcessor(ScriptBudget{}, [&waiter](v8::Isolate* iso) { return waiter.init_ctx(iso); });
+
+    run(proc, R"code(
+        var resolved = 0, rejected = 0;
+        (async function() {
+            resolved = await wait(false);
+            try {
+                await wait(true);
+            } catch(e) {
+                rejected = 1;
+            }
+        })();
+    )code");
+    pool->update_all();
+    BOOST_CHECK_EQUAL(waiter.board.pending(), 1);
+
+    // nothing is settled while the check is not done
+    waiter.board.settle(*proc);
+    BOOST_CHECK_EQUAL(read_int(proc, *pool, "resolved"), 0);
+
+    waiter.ready = true;
+    waiter.board.settle(*proc);
+    BOOST_CHECK_EQUAL(waiter.board.pending(), 0);
+    BOOST_CHECK_EQUAL(read_int(proc, *pool, "resolved"), 42);
+
+    // the second wait was added while the first one was settled
+    BOOST_CHECK_EQUAL(waiter.board.pending(), 1);
+    waiter.board.settle(*proc);
+    BOOST_CHECK_EQUAL(read_int(proc, *pool, "rejected"), 1);
+    BOOST_CHECK_EQUAL(waiter.board.pending(), 0);
+}
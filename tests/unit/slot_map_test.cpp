@@ -0,0 +1,106 @@
+#include "slot_map.hpp"
+
+#include <string>
+#include <algorithm>
+#include <testx/testx.hpp>
+
+
+TESTX_AUTO_TEST_CASE(test_slot_map_insert_find)
+{
+    SlotMap<std::string> map;
+
+    auto a = map.insert("a");
+    auto b = map.insert("b");
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_REQUIRE(map.find(a));
+    BOOST_CHECK_EQUAL(*map.find(a), "a");
+    BOOST_REQUIRE(map.find(b));
+    BOOST_CHECK_EQUAL(*map.find(b), "b");
+    BOOST_CHECK(!map.find(12345));
+}
+
+
+TESTX_AUTO_TEST_CASE(test_slot_map_stale_keys)
+{
+    SlotMap<std::string> map;
+
+    auto a = map.insert("a");
+    auto b = map.insert("b");
+    auto c = map.insert("c");
+
+    BOOST_CHECK(map.erase(a));
+    BOOST_CHECK(!map.erase(a));
+    BOOST_CHECK(!map.contains(a));
+    BOOST_CHECK_EQUAL(map.size(), 2);
+
+    // the slot is reused, but the old key stays invalid
+    auto d = map.insert("d");
+    BOOST_CHECK(d != a);
+    BOOST_CHECK(!map.find(a));
+    BOOST_CHECK_EQUAL(*map.find(d), "d");
+
+    // dense array stays packed and consistent
+    BOOST_CHECK_EQUAL(*map.find(b), "b");
+    BOOST_CHECK_EQUAL(*map.find(c), "c");
+    for(std::size_t i = 0; i < map.size(); ++i)
+    {
+        BOOST_CHECK(map.find(map.key_at(i)) == &*(map.begin() + i));
+    }
+}
+
+
+TESTX_AUTO_TEST_CASE(test_slot_map_reserve)
+{
+    SlotMap<int> map;
+
+    auto key = map.reserve();
+    BOOST_CHECK(!map.contains(key));
+    BOOST_CHECK(map.empty());
+
+    map.assign(key, 42);
+    BOOST_CHECK(map.contains(key));
+    BOOST_CHECK_EQUAL(*map.find(key), 42);
+
+    int sum = 0;
+    std::for_each(map.begin(), map.end(), [&sum](int v){ sum += v; });
+    BOOST_CHECK_EQUAL(sum, 42);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_slot_map_retires_used_up_slots)
+{
+    SlotMap<int> map;
+
+    // one slot is reused until its generations are used up
+    auto first = map.insert(0);
+    auto key = first;
+    for(SlotMap<int>::key_type gen = 0; gen < SlotMap<int>::GenerationMask; ++gen)
+    {
+        BOOST_REQUIRE(map.erase(key));
+        key = map.insert(0);
+        BOOST_REQUIRE_EQUAL(key & SlotMap<int>::IndexMask, 0);
+    }
+
+    // and is retired then, instead of handing out first again
+    BOOST_CHECK(map.erase(key));
+    BOOST_CHECK(!map.erase(key));
+    auto next = map.insert(1);
+    BOOST_CHECK_EQUAL(next & SlotMap<int>::IndexMask, 1);
+    BOOST_CHECK(next != first);
+    BOOST_CHECK(!map.contains(first));
+    BOOST_CHECK(!map.contains(key));
+    BOOST_CHECK_EQUAL(map.size(), 1);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_slot_map_full)
+{
+    SlotMap<int> map;
+    for(std::size_t i = 0; i < SlotMap<int>::MaxSize; ++i)
+    {
+        map.reserve();
+    }
+    BOOST_CHECK_THROW(map.reserve(), std::length_error);
+    BOOST_CHECK_THROW(map.insert(1), std::length_error);
+}
@@ -0,0 +1,97 @@
+#include <testx/testx.hpp>
+#include "scripting/processor.hpp"
+#include "scripting/snapshot.hpp"
+#include "scripting/binding.hpp"
+
+namespace {
+    struct Counter
+    {
+        int add(int value)
+        {
+            total += value;
+            return total;
+        }
+
+        int total = 0;
+    };
+
+    ContextBlueprint counter_blueprint()
+    {
+        return ContextBlueprint{
+            { reinterpret_cast<intptr_t>(FWrap(&Counter::add)::SlotCallback()) },
+            [](v8::Isolate* iso, v8::Local<v8::Context> ctx)
+            {
+                using namespace bd;
+                ctx->Global()->Set(ctx, str("add"), FWrap(&Counter::add)::NewSlotFunction(ctx)).FromJust();
+                // plain javascript is part of the snapshot as well
+                auto lib = Script::Compile(ctx, str("function addTwice(v) { add(v); return add(v); }")).ToLocalChecked();
+                lib->Run(ctx).ToLocalChecked();
+            }
+        };
+    }
+
+    int run(v8::Isolate* iso, v8::Local<v8::Context>& ctx, const char* code)
+    {
+        auto script = v8::Script::Compile(ctx, bd::str(code)).ToLocalChecked();
+        return script->Run(ctx).ToLocalChecked()->Int32Value(ctx).FromJust();
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_processor_from_snapshot)
+{
+    auto pool = V8ProcessorPool::Create(2);
+    auto snapshot = ContextSnapshot::Create(counter_blueprint());
+
+    Counter first, second;
+    auto bind = [](Counter& counter)
+    {
+        return [&counter](v8::Isolate* iso)
+        {
+            auto ctx = v8::Context::New(iso);
+            ctx->SetAlignedPointerInEmbedderData(bd::ThisSlot, &counter);
+            return ctx;
+        };
+    };
+    auto p1 = pool->newProcessor(ScriptBudget{}, snapshot, bind(first));
+    auto p2 = pool->newProcessor(ScriptBudget{}, snapshot, bind(second));
+
+    int r1 = 0, r2 = 0;
+    p1->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx) { r1 = run(iso, ctx, "addTwice(3)"); });
+    p2->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx) { r2 = run(iso, ctx, "add(5)"); });
+    pool->update_all();
+
+    BOOST_CHECK_EQUAL(r1, 6);
+    BOOST_CHECK_EQUAL(r2, 5);
+    BOOST_CHECK_EQUAL(first.total, 6);
+    BOOST_CHECK_EQUAL(second.total, 5);
+}
+
+TESTX_AUTO_TEST_CASE(test_snapshot_recycles_isolates)
+{
+    auto pool = V8ProcessorPool::Create(1);
+    auto snapshot = ContextSnapshot::Create(counter_blueprint());
+    BOOST_CHECK_EQUAL(snapshot->idle(), 0);
+
+    Counter counter;
+    auto init = [&counter](v8::Isolate* iso)
+    {
+        auto ctx = v8::Context::New(iso);
+        ctx->SetAlignedPointerInEmbedderData(bd::ThisSlot, &counter);
+        return ctx;
+    };
+
+    for(int i = 0; i < 3; ++i)
+    {
+        auto proc = pool->newProcessor(ScriptBudget{}, snapshot, init);
+        int result = 0;
+        proc->post([&](v8::Isolate* iso, v8::Local<v8::Context>& ctx)
+        {
+            // a fresh context every time, nothing left over from the last processor
+            result = run(iso, ctx, "typeof leftover === 'undefined' ? (leftover = 1, add(1)) : -1");
+        });
+        pool->update_all();
+        BOOST_CHECK_EQUAL(result, i + 1);
+        BOOST_CHECK_EQUAL(snapshot->idle(), 0);
+    }
+    BOOST_CHECK_EQUAL(snapshot->idle(), 1);
+}
@@ -0,0 +1,53 @@
+#include "tick_scheduler.hpp"
+
+#include <thread>
+#include <testx/testx.hpp>
+
+
+TESTX_AUTO_TEST_CASE(test_tick_scheduler_paces)
+{
+    TickScheduler scheduler(100, 5);
+    BOOST_CHECK_CLOSE(scheduler.dt(), 0.01f, 0.001);
+
+    auto start = TickScheduler::clock::now();
+    unsigned int ticks = 0;
+    while(ticks < 5)
+    {
+        ticks += scheduler.wait();
+    }
+    auto elapsed = TickScheduler::clock::now() - start;
+
+    BOOST_CHECK(elapsed >= 4 * scheduler.tick_duration());
+    BOOST_CHECK_EQUAL(scheduler.metrics().dropped_ticks, 0);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_tick_scheduler_catch_up_limit)
+{
+    TickScheduler scheduler(1000, 3);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK_EQUAL(scheduler.wait(), 3);
+    BOOST_CHECK(scheduler.metrics().dropped_ticks > 0);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_tick_scheduler_phase_metrics)
+{
+    using Phase = TickScheduler::Phase;
+    TickScheduler scheduler(100, 1);
+
+    scheduler.begin_tick();
+    {
+        auto timer = scheduler.measure(Phase::Physics);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    scheduler.end_tick();
+
+    auto& metrics = scheduler.metrics();
+    BOOST_CHECK_EQUAL(metrics.ticks, 1);
+    BOOST_CHECK(metrics.phase(Phase::Physics).last >= std::chrono::milliseconds(2));
+    BOOST_CHECK(metrics.phase(Phase::Physics).max == metrics.phase(Phase::Physics).last);
+    BOOST_CHECK(metrics.phase(Phase::Network).last == TickScheduler::duration{});
+    BOOST_CHECK(metrics.tick_last >= metrics.phase(Phase::Physics).last);
+}
@@ -0,0 +1,445 @@
+#include <testx/testx.hpp>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+#include "game.hpp"
+
+namespace {
+    struct SightChange
+    {
+        id_value_type subject;
+        id_value_type object;
+        bool insight;
+
+        bool operator==(const SightChange& other) const
+        {
+            return std::tie(subject, object, insight) == std::tie(other.subject, other.object, other.insight);
+        }
+
+        bool operator!=(const SightChange& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    std::ostream& operator<<(std::ostream& s, const SightChange& c)
+    {
+        return s << c.subject << (c.insight? " sees " : " lost ") << c.object;
+    }
+
+    using SightLog = std::vector<SightChange>;
+
+    // records the vision events between probes in the order they are fired
+    class Probe: public GameObject
+    {
+    public:
+        Probe(float sight, bool dynamic, SightLog& log, Fraction* fraction)
+            : GameObject("Probe")
+            , _sight(sight)
+            , _log(log)
+            , _fraction(fraction)
+        {
+            activate(dynamic);
+        }
+
+        virtual float sight() const override
+        {
+            return _sight;
+        }
+
+        virtual Fraction* fraction() const override
+        {
+            return _fraction;
+        }
+
+        virtual ScanResult interact_scan() override
+        {
+            return {};
+        }
+
+        virtual void on_vision(const obj_ptr& who) override
+        {
+            record(who, true);
+        }
+
+        virtual void on_vision_lost(const obj_ptr& who) override
+        {
+            record(who, false);
+        }
+
+    private:
+        void record(const obj_ptr& who, bool insight)
+        {
+            // the game's own objects, like the asteroid, are of no interest
+            if(dynamic_cast<Probe*>(who.get()))
+                _log.push_back(SightChange{id().value(), who->id().value(), insight});
+        }
+
+        const float _sight;
+        SightLog& _log;
+        Fraction* const _fraction;
+    };
+
+    // a game without players, shut down at the end of the test
+    struct TestGame
+    {
+        explicit TestGame(unsigned int simulationThreads = 1)
+        {
+            GameConfig config;
+            config.simulation_threads = simulationThreads;
+            config.script_threads = 1;
+            Game::InitializeGame(config);
+        }
+
+        ~TestGame()
+        {
+            // objects must not outlive the universe
+            probes.clear();
+            Game::Shutdown();
+        }
+
+        std::shared_ptr<Probe> add(const vec2& pos, float sight, bool dynamic = true, Fraction* fraction = nullptr)
+        {
+            auto probe = Game::Current().make_object<Probe>(sight, dynamic, log, fraction);
+            probe->set_position(pos);
+            probes.push_back(probe);
+            return probe;
+        }
+
+        // the events of one update
+        SightLog update()
+        {
+            log.clear();
+            Game::Current().universe().update(0.01f);
+            return log;
+        }
+
+        SightLog log;
+        std::vector<std::shared_ptr<Probe>> probes;
+    };
+
+    // The sight check before the spatial hash: every dynamic object against
+    // every static one, then against every later dynamic one in both directions.
+    class BruteForceSight
+    {
+    public:
+        explicit BruteForceSight(const std::vector<std::shared_ptr<Probe>>& probes)
+        {
+            for(auto& p : probes)
+            {
+                (p->active()? _dynamic : _static).push_back(p.get());
+            }
+        }
+
+        SightLog update()
+        {
+            SightLog log;
+            for(std::size_t i = 0; i < _dynamic.size(); ++i)
+            {
+                auto obj = _dynamic[i];
+                auto sight = obj->sight();
+                if(sight > 0.0f)
+                {
+                    for(auto sobj : _static)
+                    {
+                        check(log, obj, sobj, glm::distance(sobj->position(), obj->position()) < sight);
+                    }
+                }
+
+                for(std::size_t j = i + 1; j < _dynamic.size(); ++j)
+                {
+                    auto obj2 = _dynamic[j];
+                    auto dist = glm::distance(obj->position(), obj2->position());
+                    check(log, obj, obj2, dist < sight);
+                    if(obj2->sight() > 0.0f)
+                        check(log, obj2, obj, dist < obj2->sight());
+                }
+            }
+            return log;
+        }
+
+    private:
+        void check(SightLog& log, GameObject* subj, GameObject* to, bool insight)
+        {
+            auto& seen = _seen[std::make_pair(subj, to)];
+            if(seen != insight)
+            {
+                seen = insight;
+                log.push_back(SightChange{subj->id().value(), to->id().value(), insight});
+            }
+        }
+
+        std::vector<GameObject*> _dynamic;
+        std::vector<GameObject*> _static;
+        std::map<std::pair<GameObject*, GameObject*>, bool> _seen;
+    };
+
+    SightChange sees(const std::shared_ptr<Probe>& subj, const std::shared_ptr<Probe>& obj)
+    {
+        return SightChange{subj->id().value(), obj->id().value(), true};
+    }
+
+    SightChange lost(const std::shared_ptr<Probe>& subj, const std::shared_ptr<Probe>& obj)
+    {
+        return SightChange{subj->id().value(), obj->id().value(), false};
+    }
+
+    // the probes of a fraction's shared vision, by id
+    struct FractionLog
+    {
+        explicit FractionLog(Fraction& fraction)
+            : _fraction(fraction)
+            , _seen(fraction.on_vision().subscribe([this](const obj_ptr& obj){ record(obj, true); }))
+            , _lost(fraction.on_vision_lost().subscribe([this](const obj_ptr& obj){ record(obj, false); }))
+        {
+        }
+
+        // events since the last call
+        std::multiset<std::pair<id_value_type, bool>> events()
+        {
+            auto result = std::move(_events);
+            _events.clear();
+            return result;
+        }
+
+        std::set<id_value_type> visible() const
+        {
+            std::set<id_value_type> result;
+            for(auto obj : _fraction.visible_objects())
+            {
+                if(dynamic_cast<Probe*>(obj))
+                    result.insert(obj->id().value());
+            }
+            return result;
+        }
+
+    private:
+        void record(const obj_ptr& obj, bool insight)
+        {
+            if(dynamic_cast<Probe*>(obj.get()))
+                _events.emplace(obj->id().value(), insight);
+        }
+
+        Fraction& _fraction;
+        std::multiset<std::pair<id_value_type, bool>> _events{};
+        subscription _seen;
+        subscription _lost;
+    };
+
+    std::pair<id_value_type, bool> seen(const std::shared_ptr<Probe>& obj)
+    {
+        return {obj->id().value(), true};
+    }
+
+    std::pair<id_value_type, bool> gone(const std::shared_ptr<Probe>& obj)
+    {
+        return {obj->id().value(), false};
+    }
+
+    // events of a few ticks of many objects, several sight chunks of them
+    std::vector<SightLog> run_crowd(unsigned int threads)
+    {
+        TestGame game(threads);
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> coord(-300.0f, 300.0f);
+        std::uniform_real_distribution<float> step(-30.0f, 30.0f);
+        for(int i = 0; i < 400; ++i)
+        {
+            game.add(vec2(coord(rng), coord(rng)), i % 7 ? 40.0f : 0.0f, i % 10 != 0);
+        }
+
+        std::vector<SightLog> ticks;
+        for(int tick = 0; tick < 10; ++tick)
+        {
+            ticks.push_back(game.update());
+            for(auto& p : game.probes)
+            {
+                p->set_position(p->position() + vec2(step(rng), step(rng)));
+            }
+        }
+        return ticks;
+    }
+}
+
+#define CHECK_SIGHT(actual, expected) \
+    do { \
+        auto a_ = (actual); \
+        auto e_ = (expected); \
+        BOOST_CHECK_EQUAL_COLLECTIONS(a_.begin(), a_.end(), e_.begin(), e_.end()); \
+    } while(false)
+
+TESTX_AUTO_TEST_CASE(test_sight_across_cell_borders)
+{
+    // the biggest sight is 64, so cells are 64 meters wide with borders at 0 and -64
+    TestGame game;
+    auto a = game.add(vec2(-0.5f, -0.5f), 64.0f);
+    auto b = game.add(vec2(63.0f, -0.5f), 10.0f);
+    auto s = game.add(vec2(-64.4f, -0.5f), 0.0f, false);
+
+    // a sees into both neighbouring cells, b is too far away to see a
+    SightLog expected{sees(a, s), sees(a, b)};
+    CHECK_SIGHT(game.update(), expected);
+    BOOST_CHECK(game.update().empty());
+
+    // b leaves a's sight by crossing the next border
+    b->set_position(vec2(64.0f, -0.5f));
+    expected = {lost(a, b)};
+    CHECK_SIGHT(game.update(), expected);
+
+    // b jumps two cells into the negative ones, back into a's sight and next to s
+    b->set_position(vec2(-60.0f, 3.0f));
+    expected = {sees(a, b), sees(b, s)};
+    CHECK_SIGHT(game.update(), expected);
+
+    // a crosses the border at 0 too and comes into b's sight
+    a->set_position(vec2(-55.0f, 3.0f));
+    expected = {sees(b, a)};
+    CHECK_SIGHT(game.update(), expected);
+
+    // exactly at the sight distance is out of sight
+    a->set_position(vec2(4.0f, 3.0f));
+    expected = {lost(a, s), lost(a, b), lost(b, a)};
+    CHECK_SIGHT(game.update(), expected);
+
+    // a static object moves from one's sight into the other's
+    s->set_position(vec2(4.0f, -50.0f));
+    expected = {sees(a, s), lost(b, s)};
+    CHECK_SIGHT(game.update(), expected);
+}
+
+TESTX_AUTO_TEST_CASE(test_sight_matches_brute_force)
+{
+    TestGame game;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> step(-40.0f, 40.0f);
+    const float sights[] = {0.0f, 10.0f, 50.0f, 64.0f, 100.0f};
+
+    for(int i = 0; i < 60; ++i)
+    {
+        game.add(vec2(coord(rng), coord(rng)), sights[i % 5], i % 4 != 0);
+    }
+
+    BruteForceSight reference(game.probes);
+    std::size_t events = 0;
+    for(int tick = 0; tick < 50; ++tick)
+    {
+        auto actual = game.update();
+        auto expected = reference.update();
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        BOOST_REQUIRE(actual == expected);
+        events += actual.size();
+
+        // a third of the objects move, static ones included
+        for(std::size_t i = tick % 3; i < game.probes.size(); i += 3)
+        {
+            auto& p = game.probes[i];
+            p->set_position(p->position() + vec2(step(rng), step(rng)));
+        }
+    }
+    BOOST_CHECK_GT(events, 100);
+}
+
+TESTX_AUTO_TEST_CASE(test_sight_order_independent_of_workers)
+{
+    auto expected = run_crowd(1);
+    BOOST_REQUIRE_GT(expected.front().size(), 0);
+    for(unsigned int threads : {1u, 2u, 3u, 8u})
+    {
+        for(int run = 0; run < 3; ++run)
+        {
+            auto actual = run_crowd(threads);
+            BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+            for(std::size_t tick = 0; tick < actual.size(); ++tick)
+            {
+                CHECK_SIGHT(actual[tick], expected[tick]);
+            }
+        }
+    }
+}
+
+TESTX_AUTO_TEST_CASE(test_sight_change_fires_once)
+{
+    TestGame game(4);
+    auto watcher = game.add(vec2(0.0f, 0.0f), 20.0f);
+    auto mover = game.add(vec2(100.0f, 0.0f), 0.0f);
+    auto rock = game.add(vec2(-100.0f, 0.0f), 0.0f, false);
+    BOOST_CHECK(game.update().empty());
+
+    // one enter per change, nothing while it stays in sight
+    mover->set_position(vec2(10.0f, 0.0f));
+    CHECK_SIGHT(game.update(), SightLog{sees(watcher, mover)});
+    mover->set_position(vec2(-10.0f, 5.0f));
+    BOOST_CHECK(game.update().empty());
+    rock->set_position(vec2(0.0f, -19.0f));
+    CHECK_SIGHT(game.update(), SightLog{sees(watcher, rock)});
+
+    // one leave per change, nothing while it stays out of sight
+    mover->set_position(vec2(-30.0f, 0.0f));
+    CHECK_SIGHT(game.update(), SightLog{lost(watcher, mover)});
+    mover->set_position(vec2(-50.0f, 0.0f));
+    BOOST_CHECK(game.update().empty());
+
+    // leaving and entering in the same tick
+    mover->set_position(vec2(5.0f, 5.0f));
+    rock->set_position(vec2(0.0f, -21.0f));
+    CHECK_SIGHT(game.update(), (SightLog{lost(watcher, rock), sees(watcher, mover)}));
+}
+
+TESTX_AUTO_TEST_CASE(test_fraction_vision)
+{
+    using Events = std::multiset<std::pair<id_value_type, bool>>;
+    using Ids = std::set<id_value_type>;
+
+    // must outlive the game's objects
+    Fraction allies(fraction_id{1000}, "allies");
+    TestGame game(2);
+    FractionLog log(allies);
+    auto a = game.add(vec2(0.0f, 0.0f), 20.0f, true, &allies);
+    auto b = game.add(vec2(100.0f, 0.0f), 20.0f, true, &allies);
+    auto t = game.add(vec2(10.0f, 0.0f), 0.0f);
+    auto far = game.add(vec2(300.0f, 0.0f), 0.0f);
+    auto rock = game.add(vec2(110.0f, 0.0f), 0.0f, false);
+    auto id = [](const std::shared_ptr<Probe>& p) { return p->id().value(); };
+
+    // the union of the members' sight, the members included
+    game.update();
+    BOOST_CHECK(log.events() == (Events{seen(a), seen(b), seen(t), seen(rock)}));
+    BOOST_CHECK(log.visible() == (Ids{id(a), id(b), id(t), id(rock)}));
+    game.update();
+    BOOST_CHECK(log.events().empty());
+
+    // b comes into sight of t too, but the fraction saw t already
+    b->set_position(vec2(25.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events() == (Events{gone(rock)}));
+    BOOST_CHECK(log.visible() == (Ids{id(a), id(b), id(t)}));
+
+    // t is lost only when the last member loses it
+    a->set_position(vec2(-50.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events().empty());
+    t->set_position(vec2(60.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events() == (Events{gone(t)}));
+    BOOST_CHECK(log.visible() == (Ids{id(a), id(b)}));
+
+    // two members coming into sight of t at once, one event
+    t->set_position(vec2(-45.0f, 0.0f));
+    b->set_position(vec2(-40.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events() == (Events{seen(t)}));
+    BOOST_CHECK(log.visible() == (Ids{id(a), id(b), id(t)}));
+
+    // one member leaves t for something new, the other still sees t
+    b->set_position(vec2(290.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events() == (Events{seen(far)}));
+    a->set_position(vec2(-100.0f, 0.0f));
+    game.update();
+    BOOST_CHECK(log.events() == (Events{gone(t)}));
+    BOOST_CHECK(log.visible() == (Ids{id(a), id(b), id(far)}));
+}
@@ -0,0 +1,139 @@
+#include "server/world_stream.hpp"
+
+#include <stdexcept>
+#include <testx/testx.hpp>
+
+using namespace world_stream;
+
+namespace {
+    const std::string& name_of(id_value_type id)
+    {
+        static std::unordered_map<id_value_type, std::string> names;
+        auto& name = names[id];
+        if(name.empty())
+            name = "obj" + std::to_string(id);
+        return name;
+    }
+
+    std::vector<ObjectState> make_states(std::size_t count, float offset)
+    {
+        std::vector<ObjectState> states;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            states.push_back(quantize(id_value_type(i * 3 + 1), vec2(i * 10.0f + offset, -5.0f), vec2(offset, 1.0f)));
+        }
+        return states;
+    }
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_quantize)
+{
+    auto state = quantize(7, vec2(10.5f, -3.25f), vec2(0.03f, 2.0f));
+    BOOST_CHECK_EQUAL(state.id, 7);
+    BOOST_CHECK_EQUAL(position_of(state).x, 10.5f);
+    BOOST_CHECK_EQUAL(position_of(state).y, -3.25f);
+    BOOST_CHECK_EQUAL(velocity_of(state).x, 0.0f);
+    BOOST_CHECK_EQUAL(velocity_of(state).y, 2.0f);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_full_snapshot)
+{
+    Encoder encoder;
+    Decoder decoder;
+
+    auto states = make_states(20, 0.0f);
+    auto& message = encoder.encode(states, name_of);
+    BOOST_CHECK_EQUAL(decoder.decode(message), 1);
+    BOOST_CHECK(decoder.states() == states);
+    BOOST_CHECK_EQUAL(decoder.name(4), "obj4");
+
+    // without ack every message is a full snapshot
+    auto& again = encoder.encode(states, name_of);
+    BOOST_CHECK_EQUAL(encoder.baseline(), 0);
+    BOOST_CHECK_EQUAL(decoder.decode(again), 2);
+    BOOST_CHECK(decoder.states() == states);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_delta)
+{
+    Encoder encoder;
+    Decoder decoder;
+
+    auto states = make_states(50, 0.0f);
+    auto fullSize = encoder.encode(states, name_of).size();
+    encoder.ack(decoder.decode(encoder.encode(states, name_of)));
+
+    // nothing changed
+    auto& unchanged = encoder.encode(states, name_of);
+    BOOST_CHECK_EQUAL(unchanged.size(), 4);
+    decoder.decode(unchanged);
+    BOOST_CHECK(decoder.states() == states);
+
+    // everything moved a bit, one removed, one added
+    auto moved = make_states(50, 0.5f);
+    moved.erase(moved.begin() + 10);
+    moved.push_back(quantize(1000, vec2(1.0f, 2.0f), vec2()));
+    auto& delta = encoder.encode(moved, name_of);
+    BOOST_CHECK(delta.size() < fullSize / 2);
+    decoder.decode(delta);
+    BOOST_CHECK(decoder.states() == moved);
+    BOOST_CHECK_EQUAL(decoder.name(1000), "obj1000");
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_lost_messages)
+{
+    Encoder encoder;
+    Decoder decoder;
+
+    encoder.ack(decoder.decode(encoder.encode(make_states(10, 0.0f), name_of)));
+
+    // messages in between get lost, deltas still refer to the acknowledged baseline
+    encoder.encode(make_states(8, 1.0f), name_of);
+    encoder.encode(make_states(12, 2.0f), name_of);
+    auto states = make_states(9, 3.0f);
+    decoder.decode(encoder.encode(states, name_of));
+    BOOST_CHECK_EQUAL(encoder.baseline(), 1);
+    BOOST_CHECK(decoder.states() == states);
+
+    // stale and unknown acks are ignored
+    encoder.ack(1);
+    encoder.ack(100);
+    BOOST_CHECK_EQUAL(encoder.baseline(), 1);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_old_baseline)
+{
+    Encoder encoder;
+    Decoder decoder;
+
+    encoder.ack(decoder.decode(encoder.encode(make_states(10, 0.0f), name_of)));
+    for(std::uint32_t i = 0; i < HistorySize; ++i)
+    {
+        encoder.encode(make_states(10, float(i)), name_of);
+    }
+
+    // the client forgot the baseline, so a full snapshot is sent
+    Decoder fresh;
+    auto states = make_states(10, 42.0f);
+    fresh.decode(encoder.encode(states, name_of));
+    BOOST_CHECK_EQUAL(encoder.baseline(), 0);
+    BOOST_CHECK(fresh.states() == states);
+}
+
+
+TESTX_AUTO_TEST_CASE(test_world_stream_unknown_baseline)
+{
+    Encoder encoder;
+    Decoder first;
+    Decoder second;
+
+    auto states = make_states(5, 0.0f);
+    encoder.ack(first.decode(encoder.encode(states, name_of)));
+    BOOST_CHECK_THROW(second.decode(encoder.encode(states, name_of)), std::runtime_error);
+    BOOST_CHECK_THROW(second.decode(std::string("\x05", 1)), std::runtime_error);
+}